@@ -0,0 +1,577 @@
+// Copyright Roman K. All Rights Reserved.
+
+#include "PCGCActorIndexSubsystem.h"
+
+#include "PCGModule.h"
+#include "Elements/PCGActorSelector.h"
+#include "Grid/PCGPartitionActor.h"
+#include "Helpers/PCGHelpers.h"
+
+#include "Algo/AnyOf.h"
+#include "Algo/Sort.h"
+#include "Components/SceneComponent.h"
+#include "Engine/Engine.h"
+#include "Engine/Level.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/Actor.h"
+#include "HAL/IConsoleManager.h"
+
+#if WITH_EDITOR
+#include "Misc/TransactionObjectEvent.h"
+#include "UObject/UObjectGlobals.h"
+#endif
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(PCGCActorIndexSubsystem)
+
+namespace PCGCActorIndexHelpers
+{
+	static TAutoConsoleVariable<float> CVarGridCellSize(
+		TEXT("pcgc.ActorIndex.GridCellSize"),
+		25600.0f,
+		TEXT("Size of the grid cells used by the actor index to narrow down queries that must overlap the source actor. Changing it rebuilds the index."));
+
+	/** Actors covering more cells than this are not put in the grid, they are always visited by overlap queries. */
+	static constexpr int64 MaxCellsPerActor = 64;
+
+	/** Queries overlapping more cells than this don't use the grid. */
+	static constexpr int64 MaxCellsPerQuery = 4096;
+
+	static double GetGridCellSize()
+	{
+		return FMath::Max(static_cast<double>(CVarGridCellSize.GetValueOnGameThread()), 100.0);
+	}
+
+	static int64 GetNumCells(const FIntVector& MinCell, const FIntVector& MaxCell)
+	{
+		return int64(MaxCell.X - MinCell.X + 1) * int64(MaxCell.Y - MinCell.Y + 1) * int64(MaxCell.Z - MinCell.Z + 1);
+	}
+
+	template <typename Func>
+	static void ForEachCell(const FIntVector& MinCell, const FIntVector& MaxCell, Func&& Callback)
+	{
+		for (int32 Z = MinCell.Z; Z <= MaxCell.Z; ++Z)
+		{
+			for (int32 Y = MinCell.Y; Y <= MaxCell.Y; ++Y)
+			{
+				for (int32 X = MinCell.X; X <= MaxCell.X; ++X)
+				{
+					Callback(FIntVector(X, Y, Z));
+				}
+			}
+		}
+	}
+
+	static FAutoConsoleCommandWithWorld CommandStats(
+		TEXT("pcgc.ActorIndex.Stats"),
+		TEXT("Logs the size and query counters of the actor index of the current world."),
+		FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+		{
+			if (const UPCGCActorIndexSubsystem* ActorIndex = UPCGCActorIndexSubsystem::Get(World))
+			{
+				const FPCGCActorIndexStats Stats = ActorIndex->GetStats();
+				UE_LOG(LogPCG, Log, TEXT("Actor index: %d actors, %d tags, %d classes, %d grid cells, %lld queries (%lld narrowed by the grid)"), Stats.NumActors, Stats.NumTags, Stats.NumClasses, Stats.NumGridCells, Stats.NumQueries, Stats.NumGridQueries);
+			}
+		}));
+}
+
+UPCGCActorIndexSubsystem* UPCGCActorIndexSubsystem::Get(const UWorld* World)
+{
+	return World ? World->GetSubsystem<UPCGCActorIndexSubsystem>() : nullptr;
+}
+
+void UPCGCActorIndexSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	UWorld* World = GetWorld();
+	check(World);
+
+	// Actors only move in game worlds through gameplay, where the mobility can be trusted. In editor, overlap queries only use the tag and class index.
+	bUseGrid = World->IsGameWorld();
+
+	ActorSpawnedHandle = World->AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &UPCGCActorIndexSubsystem::OnActorSpawned));
+	ActorDestroyedHandle = World->AddOnActorDestroyedHandler(FOnActorDestroyed::FDelegate::CreateUObject(this, &UPCGCActorIndexSubsystem::OnActorDestroyed));
+	LevelAddedHandle = FWorldDelegates::LevelAddedToWorld.AddUObject(this, &UPCGCActorIndexSubsystem::OnLevelAdded);
+	LevelRemovedHandle = FWorldDelegates::LevelRemovedFromWorld.AddUObject(this, &UPCGCActorIndexSubsystem::OnLevelRemoved);
+
+#if WITH_EDITOR
+	if (GEngine)
+	{
+		LevelActorAddedHandle = GEngine->OnLevelActorAdded().AddUObject(this, &UPCGCActorIndexSubsystem::OnLevelActorAdded);
+		LevelActorDeletedHandle = GEngine->OnLevelActorDeleted().AddUObject(this, &UPCGCActorIndexSubsystem::OnLevelActorDeleted);
+	}
+
+	ObjectPropertyChangedHandle = FCoreUObjectDelegates::OnObjectPropertyChanged.AddUObject(this, &UPCGCActorIndexSubsystem::OnObjectPropertyChanged);
+	ObjectTransactedHandle = FCoreUObjectDelegates::OnObjectTransacted.AddUObject(this, &UPCGCActorIndexSubsystem::OnObjectTransacted);
+	LoadedActorAddedHandle = ULevel::OnLoadedActorAddedToLevelEvent.AddUObject(this, &UPCGCActorIndexSubsystem::OnLoadedActorAdded);
+	LoadedActorRemovedHandle = ULevel::OnLoadedActorRemovedFromLevelEvent.AddUObject(this, &UPCGCActorIndexSubsystem::OnLoadedActorRemoved);
+	ObjectsReplacedHandle = FCoreUObjectDelegates::OnObjectsReplaced.AddUObject(this, &UPCGCActorIndexSubsystem::OnObjectsReplaced);
+#endif
+}
+
+void UPCGCActorIndexSubsystem::Deinitialize()
+{
+	if (UWorld* World = GetWorld())
+	{
+		World->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
+		World->RemoveOnActorDestroyededHandler(ActorDestroyedHandle);
+	}
+
+	FWorldDelegates::LevelAddedToWorld.Remove(LevelAddedHandle);
+	FWorldDelegates::LevelRemovedFromWorld.Remove(LevelRemovedHandle);
+
+#if WITH_EDITOR
+	if (GEngine)
+	{
+		GEngine->OnLevelActorAdded().Remove(LevelActorAddedHandle);
+		GEngine->OnLevelActorDeleted().Remove(LevelActorDeletedHandle);
+	}
+
+	FCoreUObjectDelegates::OnObjectPropertyChanged.Remove(ObjectPropertyChangedHandle);
+	FCoreUObjectDelegates::OnObjectTransacted.Remove(ObjectTransactedHandle);
+	ULevel::OnLoadedActorAddedToLevelEvent.Remove(LoadedActorAddedHandle);
+	ULevel::OnLoadedActorRemovedFromLevelEvent.Remove(LoadedActorRemovedHandle);
+	FCoreUObjectDelegates::OnObjectsReplaced.Remove(ObjectsReplacedHandle);
+#endif
+
+	Reset();
+
+	Super::Deinitialize();
+}
+
+void UPCGCActorIndexSubsystem::NotifyActorTagsChanged(AActor* Actor)
+{
+	if (bIsBuilt && Actor && Actor->GetWorld() == GetWorld())
+	{
+		AddActor(Actor);
+	}
+}
+
+bool UPCGCActorIndexSubsystem::FindActors(const FPCGActorSelectorSettings& Selector, const FBox& OverlapBounds, TFunctionRef<bool(const AActor*)> Filter, TArray<AActor*>& OutActors)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UPCGCActorIndexSubsystem::FindActors);
+
+	if (Selector.ActorFilter != EPCGActorFilter::AllWorldActors)
+	{
+		return false;
+	}
+
+	const bool bByTag = Selector.ActorSelection == EPCGActorSelection::ByTag && Selector.ActorSelectionTag != NAME_None;
+	const bool bByClass = Selector.ActorSelection == EPCGActorSelection::ByClass && Selector.ActorSelectionClass;
+	if (!bByTag && !bByClass)
+	{
+		return false;
+	}
+
+	if (!bIsBuilt || GridCellSize != PCGCActorIndexHelpers::GetGridCellSize())
+	{
+		Reset();
+		BuildIndex();
+	}
+
+	++NumQueries;
+
+	// Sets of the actors matching the selection, tags and classes are re-checked on the actors since they can change without notice
+	TArray<const TSet<TObjectKey<AActor>>*, TInlineAllocator<8>> MatchingSets;
+	int64 NumMatches = 0;
+
+	if (bByTag)
+	{
+		if (const TSet<TObjectKey<AActor>>* Actors = TagToActors.Find(Selector.ActorSelectionTag))
+		{
+			MatchingSets.Add(Actors);
+			NumMatches += Actors->Num();
+		}
+	}
+	else
+	{
+		for (const TPair<TObjectKey<UClass>, TSet<TObjectKey<AActor>>>& ClassActors : ClassToActors)
+		{
+			const UClass* Class = ClassActors.Key.ResolveObjectPtr();
+			if (Class && Class->IsChildOf(Selector.ActorSelectionClass))
+			{
+				MatchingSets.Add(&ClassActors.Value);
+				NumMatches += ClassActors.Value.Num();
+			}
+		}
+	}
+
+	auto TryAddActor = [&Selector, bByTag, &Filter, &OutActors](TObjectKey<AActor> ActorKey)
+	{
+		AActor* Actor = ActorKey.ResolveObjectPtr();
+		if (!Actor || !IsValid(Actor))
+		{
+			return;
+		}
+
+		const bool bMatches = bByTag ? Actor->ActorHasTag(Selector.ActorSelectionTag) : Actor->IsA(Selector.ActorSelectionClass);
+		if (bMatches && Filter(Actor))
+		{
+			OutActors.Add(Actor);
+		}
+	};
+
+	// The grid is only worth it when the overlapped cells and the actors outside of the grid are fewer than the matching actors
+	bool bUsedGrid = false;
+	if (bUseGrid && OverlapBounds.IsValid && NumMatches > 0)
+	{
+		const FIntVector MinCell = GetCell(OverlapBounds.Min);
+		const FIntVector MaxCell = GetCell(OverlapBounds.Max);
+
+		if (PCGCActorIndexHelpers::GetNumCells(MinCell, MaxCell) <= PCGCActorIndexHelpers::MaxCellsPerQuery)
+		{
+			int64 NumCandidates = UngriddedActors.Num();
+			PCGCActorIndexHelpers::ForEachCell(MinCell, MaxCell, [this, &NumCandidates](const FIntVector& Cell)
+			{
+				if (const TSet<TObjectKey<AActor>>* CellActors = Grid.Find(Cell))
+				{
+					NumCandidates += CellActors->Num();
+				}
+			});
+
+			if (NumCandidates < NumMatches)
+			{
+				++NumGridQueries;
+				bUsedGrid = true;
+
+				// Actors spanning several cells are visited once
+				TSet<TObjectKey<AActor>> VisitedActors;
+				PCGCActorIndexHelpers::ForEachCell(MinCell, MaxCell, [this, &VisitedActors, &TryAddActor](const FIntVector& Cell)
+				{
+					if (const TSet<TObjectKey<AActor>>* CellActors = Grid.Find(Cell))
+					{
+						for (TObjectKey<AActor> ActorKey : *CellActors)
+						{
+							bool bAlreadyVisited = false;
+							VisitedActors.Add(ActorKey, &bAlreadyVisited);
+							if (!bAlreadyVisited)
+							{
+								TryAddActor(ActorKey);
+							}
+						}
+					}
+				});
+
+				for (TObjectKey<AActor> ActorKey : UngriddedActors)
+				{
+					TryAddActor(ActorKey);
+				}
+			}
+		}
+	}
+
+	if (!bUsedGrid)
+	{
+		for (const TSet<TObjectKey<AActor>>* Actors : MatchingSets)
+		{
+			for (TObjectKey<AActor> ActorKey : *Actors)
+			{
+				TryAddActor(ActorKey);
+			}
+		}
+	}
+
+	// Set iteration order depends on the insertion history, sort so that the found actors don't depend on it
+	Algo::Sort(OutActors, [](const AActor* A, const AActor* B)
+	{
+		const int32 Comparison = A->GetFName().Compare(B->GetFName());
+		return Comparison != 0 ? Comparison < 0 : A->GetPathName() < B->GetPathName();
+	});
+
+	if (!Selector.bSelectMultiple && OutActors.Num() > 1)
+	{
+		OutActors.SetNum(1);
+	}
+
+	return true;
+}
+
+FPCGCActorIndexStats UPCGCActorIndexSubsystem::GetStats() const
+{
+	FPCGCActorIndexStats Stats;
+	Stats.NumActors = IndexedActors.Num();
+	Stats.NumTags = TagToActors.Num();
+	Stats.NumClasses = ClassToActors.Num();
+	Stats.NumGridCells = Grid.Num();
+	Stats.NumQueries = NumQueries;
+	Stats.NumGridQueries = NumGridQueries;
+	return Stats;
+}
+
+void UPCGCActorIndexSubsystem::Reset()
+{
+	IndexedActors.Empty();
+	TagToActors.Empty();
+	ClassToActors.Empty();
+	Grid.Empty();
+	UngriddedActors.Empty();
+	bIsBuilt = false;
+}
+
+void UPCGCActorIndexSubsystem::BuildIndex()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UPCGCActorIndexSubsystem::BuildIndex);
+
+	GridCellSize = PCGCActorIndexHelpers::GetGridCellSize();
+	bIsBuilt = true;
+
+	if (UWorld* World = GetWorld())
+	{
+		for (TActorIterator<AActor> It(World); It; ++It)
+		{
+			AddActor(*It);
+		}
+	}
+}
+
+void UPCGCActorIndexSubsystem::AddActor(AActor* Actor)
+{
+	if (!Actor || !IsValid(Actor))
+	{
+		return;
+	}
+
+	// Re-indexing an actor starts from scratch, its tags or bounds may have changed
+	const TObjectKey<AActor> ActorKey(Actor);
+	RemoveActor(ActorKey);
+
+	FIndexedActor& Entry = IndexedActors.Add(ActorKey);
+	Entry.Class = Actor->GetClass();
+	ClassToActors.FindOrAdd(Entry.Class).Add(ActorKey);
+
+	Entry.Tags.Reserve(Actor->Tags.Num());
+	for (const FName& Tag : Actor->Tags)
+	{
+		if (Tag != NAME_None && !Entry.Tags.Contains(Tag))
+		{
+			Entry.Tags.Add(Tag);
+			TagToActors.FindOrAdd(Tag).Add(ActorKey);
+		}
+	}
+
+	if (bUseGrid && CanBeInGrid(Actor))
+	{
+		const FBox Bounds = PCGHelpers::GetActorBounds(Actor);
+		if (Bounds.IsValid)
+		{
+			Entry.MinCell = GetCell(Bounds.Min);
+			Entry.MaxCell = GetCell(Bounds.Max);
+			Entry.bIsInGrid = PCGCActorIndexHelpers::GetNumCells(Entry.MinCell, Entry.MaxCell) <= PCGCActorIndexHelpers::MaxCellsPerActor;
+		}
+	}
+
+	if (Entry.bIsInGrid)
+	{
+		PCGCActorIndexHelpers::ForEachCell(Entry.MinCell, Entry.MaxCell, [this, ActorKey](const FIntVector& Cell)
+		{
+			Grid.FindOrAdd(Cell).Add(ActorKey);
+		});
+	}
+	else
+	{
+		UngriddedActors.Add(ActorKey);
+	}
+}
+
+void UPCGCActorIndexSubsystem::RemoveActor(const AActor* Actor)
+{
+	if (Actor)
+	{
+		RemoveActor(TObjectKey<AActor>(Actor));
+	}
+}
+
+void UPCGCActorIndexSubsystem::RemoveActor(TObjectKey<AActor> ActorKey)
+{
+	FIndexedActor Entry;
+	if (!IndexedActors.RemoveAndCopyValue(ActorKey, Entry))
+	{
+		return;
+	}
+
+	auto RemoveFromSet = [ActorKey](auto& Map, const auto& Key)
+	{
+		if (auto* Actors = Map.Find(Key))
+		{
+			Actors->Remove(ActorKey);
+			if (Actors->IsEmpty())
+			{
+				Map.Remove(Key);
+			}
+		}
+	};
+
+	RemoveFromSet(ClassToActors, Entry.Class);
+
+	for (const FName& Tag : Entry.Tags)
+	{
+		RemoveFromSet(TagToActors, Tag);
+	}
+
+	if (Entry.bIsInGrid)
+	{
+		PCGCActorIndexHelpers::ForEachCell(Entry.MinCell, Entry.MaxCell, [this, &RemoveFromSet](const FIntVector& Cell)
+		{
+			RemoveFromSet(Grid, Cell);
+		});
+	}
+	else
+	{
+		UngriddedActors.Remove(ActorKey);
+	}
+}
+
+bool UPCGCActorIndexSubsystem::CanBeInGrid(const AActor* Actor) const
+{
+	// Partition actors are matched against the grid bounds of the querying component, not their own bounds
+	if (Actor->IsA<APCGPartitionActor>() || !Actor->IsRootComponentStatic())
+	{
+		return false;
+	}
+
+	// A static root can still have movable children
+	TInlineComponentArray<USceneComponent*> SceneComponents(Actor);
+	return !Algo::AnyOf(SceneComponents, [](const USceneComponent* SceneComponent) { return SceneComponent && SceneComponent->Mobility != EComponentMobility::Static; });
+}
+
+FIntVector UPCGCActorIndexSubsystem::GetCell(const FVector& Position) const
+{
+	return FIntVector(
+		FMath::FloorToInt32(Position.X / GridCellSize),
+		FMath::FloorToInt32(Position.Y / GridCellSize),
+		FMath::FloorToInt32(Position.Z / GridCellSize));
+}
+
+void UPCGCActorIndexSubsystem::OnActorSpawned(AActor* Actor)
+{
+	// Before the first query, the actor will be found when building the index
+	if (bIsBuilt)
+	{
+		AddActor(Actor);
+	}
+}
+
+void UPCGCActorIndexSubsystem::OnActorDestroyed(AActor* Actor)
+{
+	RemoveActor(Actor);
+}
+
+void UPCGCActorIndexSubsystem::OnLevelAdded(ULevel* Level, UWorld* World)
+{
+	if (!bIsBuilt || !Level || World != GetWorld())
+	{
+		return;
+	}
+
+	for (AActor* Actor : Level->Actors)
+	{
+		AddActor(Actor);
+	}
+}
+
+void UPCGCActorIndexSubsystem::OnLevelRemoved(ULevel* Level, UWorld* World)
+{
+	if (!bIsBuilt || World != GetWorld())
+	{
+		return;
+	}
+
+	// A null level means every level was removed
+	if (!Level)
+	{
+		Reset();
+		return;
+	}
+
+	for (AActor* Actor : Level->Actors)
+	{
+		RemoveActor(Actor);
+	}
+}
+
+#if WITH_EDITOR
+void UPCGCActorIndexSubsystem::OnLevelActorAdded(AActor* Actor)
+{
+	if (bIsBuilt && Actor && Actor->GetWorld() == GetWorld())
+	{
+		AddActor(Actor);
+	}
+}
+
+void UPCGCActorIndexSubsystem::OnLevelActorDeleted(AActor* Actor)
+{
+	RemoveActor(Actor);
+}
+
+void UPCGCActorIndexSubsystem::OnObjectPropertyChanged(UObject* Object, FPropertyChangedEvent& PropertyChangedEvent)
+{
+	AActor* Actor = Cast<AActor>(Object);
+	if (!bIsBuilt || !Actor || Actor->GetWorld() != GetWorld())
+	{
+		return;
+	}
+
+	const FName MemberPropertyName = PropertyChangedEvent.GetMemberPropertyName();
+	if (MemberPropertyName == NAME_None || MemberPropertyName == GET_MEMBER_NAME_CHECKED(AActor, Tags))
+	{
+		AddActor(Actor);
+	}
+}
+
+void UPCGCActorIndexSubsystem::OnObjectTransacted(UObject* Object, const FTransactionObjectEvent& TransactionEvent)
+{
+	// Undo/redo can bring back deleted actors and restore tags without going through the other delegates
+	AActor* Actor = Cast<AActor>(Object);
+	if (!bIsBuilt || !Actor || Actor->GetWorld() != GetWorld())
+	{
+		return;
+	}
+
+	if (IsValid(Actor))
+	{
+		AddActor(Actor);
+	}
+	else
+	{
+		RemoveActor(Actor);
+	}
+}
+
+void UPCGCActorIndexSubsystem::OnLoadedActorAdded(AActor& Actor)
+{
+	// Actors loaded by World Partition loading regions are added to their level without the spawned or level actor added delegates
+	if (bIsBuilt && Actor.GetWorld() == GetWorld())
+	{
+		AddActor(&Actor);
+	}
+}
+
+void UPCGCActorIndexSubsystem::OnLoadedActorRemoved(AActor& Actor)
+{
+	RemoveActor(&Actor);
+}
+
+void UPCGCActorIndexSubsystem::OnObjectsReplaced(const TMap<UObject*, UObject*>& ReplacementMap)
+{
+	// Blueprint reinstancing replaces actors by new objects, the old ones are never reported as destroyed
+	if (!bIsBuilt)
+	{
+		return;
+	}
+
+	for (const TPair<UObject*, UObject*>& Replacement : ReplacementMap)
+	{
+		if (const AActor* OldActor = Cast<AActor>(Replacement.Key))
+		{
+			RemoveActor(OldActor);
+		}
+
+		AActor* NewActor = Cast<AActor>(Replacement.Value);
+		if (NewActor && NewActor->GetWorld() == GetWorld())
+		{
+			AddActor(NewActor);
+		}
+	}
+}
+#endif
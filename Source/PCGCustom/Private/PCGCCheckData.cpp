@@ -6,9 +6,7 @@
 #include "Data/PCGSpatialData.h"
 #include "Data/PCGPointData.h"
 #include "PCGParamData.h"
-#include "Data/PCGIntersectionData.h"
-#include "Data/PCGDifferenceData.h"
-#include "Data/PCGUnionData.h"
+#include "PCGCDataHelpers.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(PCGCCheckData)
 
@@ -121,10 +119,10 @@ bool FPCGCCheckDataElement::ExecuteInternal(FPCGContext* Context) const
 					Output1.Pin = PCGPinConstants::DefaultOutputLabel;
 				}
 			}
-			else if (Cast<UPCGIntersectionData>(Input.Data.Get()) || Cast<UPCGDifferenceData>(Input.Data.Get()) || Cast<UPCGUnionData>(Input.Data.Get()))
+			else if (PCGCDataHelpers::IsCompositeData(Input.Data.Get()))
 			{
 				const UPCGSpatialData* IntData = Cast<UPCGSpatialData>(Input.Data.Get());
-				if (IntData->GetStrictBounds().IsValid)
+				if (!PCGCDataHelpers::IsCompositeDataEmpty(IntData, Settings->bSampledCompositeCheck, Settings->SampledCheckMaxLevel))
 				{
 					FPCGTaggedData& Output1 = Outputs.Add_GetRef(Input);
 					Output1.Pin = PCGPinConstants::DefaultOutputLabel;
@@ -0,0 +1,170 @@
+// Copyright Roman K. All Rights Reserved.
+
+#include "PCGCDataCache.h"
+
+#include "PCGData.h"
+#include "PCGParamData.h"
+#include "Data/PCGPointData.h"
+
+FPCGCDataCache::FPCGCDataCache(const TCHAR* InName, int64 InMemoryBudget)
+	: Name(InName)
+	, MemoryBudget(InMemoryBudget)
+{
+}
+
+const UPCGData* FPCGCDataCache::Find(uint64 Key, const UObject* Source)
+{
+	FScopeLock ScopeLock(&Lock);
+
+	const FObjectKey SourceKey(Source);
+	return Find_Locked(Key, [Source, &SourceKey](const FEntry& Entry) { return !Source || Entry.Source == SourceKey; });
+}
+
+const UPCGData* FPCGCDataCache::Find(uint64 Key, uint64 Check)
+{
+	FScopeLock ScopeLock(&Lock);
+
+	return Find_Locked(Key, [Check](const FEntry& Entry) { return Entry.Check == Check; });
+}
+
+void FPCGCDataCache::Add(uint64 Key, const UPCGData* Data, const UObject* Source)
+{
+	if (!Data)
+	{
+		return;
+	}
+
+	const int64 DataMemorySize = ComputeMemorySize(Data);
+
+	FScopeLock ScopeLock(&Lock);
+	Add_Locked(Key, Data, DataMemorySize, FObjectKey(Source), /*Check=*/0);
+}
+
+void FPCGCDataCache::Add(uint64 Key, const UPCGData* Data, uint64 Check)
+{
+	if (!Data)
+	{
+		return;
+	}
+
+	const int64 DataMemorySize = ComputeMemorySize(Data);
+
+	FScopeLock ScopeLock(&Lock);
+	Add_Locked(Key, Data, DataMemorySize, FObjectKey(), Check);
+}
+
+const UPCGData* FPCGCDataCache::Find_Locked(uint64 Key, TFunctionRef<bool(const FEntry&)> IsValidHit)
+{
+	FEntry* Entry = Entries.Find(Key);
+	if (Entry && IsValidHit(*Entry))
+	{
+		Entry->LastAccess = ++AccessCounter;
+		++Stats.Hits;
+		return Entry->Data;
+	}
+
+	++Stats.Misses;
+	return nullptr;
+}
+
+void FPCGCDataCache::Add_Locked(uint64 Key, const UPCGData* Data, int64 DataMemorySize, const FObjectKey& Source, uint64 Check)
+{
+	FEntry& Entry = Entries.FindOrAdd(Key);
+	MemorySize += DataMemorySize - Entry.MemorySize;
+
+	Entry.Data = Data;
+	Entry.Source = Source;
+	Entry.Check = Check;
+	Entry.MemorySize = DataMemorySize;
+	Entry.LastAccess = ++AccessCounter;
+
+	EvictToBudget_Locked();
+}
+
+void FPCGCDataCache::Remove(uint64 Key)
+{
+	FScopeLock ScopeLock(&Lock);
+
+	FEntry Removed;
+	if (Entries.RemoveAndCopyValue(Key, Removed))
+	{
+		MemorySize -= Removed.MemorySize;
+	}
+}
+
+void FPCGCDataCache::SetMemoryBudget(int64 InMemoryBudget)
+{
+	FScopeLock ScopeLock(&Lock);
+
+	MemoryBudget = InMemoryBudget;
+	EvictToBudget_Locked();
+}
+
+void FPCGCDataCache::Reset()
+{
+	FScopeLock ScopeLock(&Lock);
+
+	Entries.Reset();
+	MemorySize = 0;
+}
+
+FPCGCDataCacheStats FPCGCDataCache::GetStats() const
+{
+	FScopeLock ScopeLock(&Lock);
+
+	FPCGCDataCacheStats Result = Stats;
+	Result.NumEntries = Entries.Num();
+	Result.MemorySize = MemorySize;
+	return Result;
+}
+
+int64 FPCGCDataCache::ComputeMemorySize(const UPCGData* Data)
+{
+	int64 Size = Data ? Data->GetClass()->GetStructureSize() : 0;
+
+	if (const UPCGPointData* PointData = Cast<UPCGPointData>(Data))
+	{
+		Size += PointData->GetPoints().GetAllocatedSize();
+		Size += PointData->ConstMetadata() ? PointData->ConstMetadata()->GetLocalItemCount() * sizeof(PCGMetadataValueKey) : 0;
+	}
+	else if (const UPCGParamData* ParamData = Cast<UPCGParamData>(Data))
+	{
+		Size += ParamData->ConstMetadata() ? ParamData->ConstMetadata()->GetLocalItemCount() * sizeof(PCGMetadataValueKey) : 0;
+	}
+
+	return Size;
+}
+
+void FPCGCDataCache::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	FScopeLock ScopeLock(&Lock);
+
+	for (TPair<uint64, FEntry>& Entry : Entries)
+	{
+		Collector.AddReferencedObject(Entry.Value.Data);
+	}
+}
+
+void FPCGCDataCache::EvictToBudget_Locked()
+{
+	// Evictions are rare compared to lookups, so a linear scan for the oldest entry is cheaper than maintaining a list
+	while (MemorySize > MemoryBudget && !Entries.IsEmpty())
+	{
+		uint64 OldestKey = 0;
+		uint64 OldestAccess = MAX_uint64;
+
+		for (const TPair<uint64, FEntry>& Entry : Entries)
+		{
+			if (Entry.Value.LastAccess < OldestAccess)
+			{
+				OldestAccess = Entry.Value.LastAccess;
+				OldestKey = Entry.Key;
+			}
+		}
+
+		FEntry Evicted;
+		Entries.RemoveAndCopyValue(OldestKey, Evicted);
+		MemorySize -= Evicted.MemorySize;
+		++Stats.Evictions;
+	}
+}
@@ -0,0 +1,219 @@
+// Copyright Roman K. All Rights Reserved.
+
+#include "PCGCDataHelpers.h"
+
+#include "PCGCMemoizedSpatialData.h"
+#include "PCGModule.h"
+#include "Data/PCGSpatialData.h"
+#include "Data/PCGIntersectionData.h"
+#include "Data/PCGDifferenceData.h"
+#include "Data/PCGUnionData.h"
+#include "Data/PCGPointData.h"
+#include "Metadata/PCGMetadata.h"
+
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/ScopeLock.h"
+
+#include <atomic>
+
+namespace PCGCDataHelpers
+{
+	static TAutoConsoleVariable<int32> CVarMaxCachedResults(
+		TEXT("pcgc.SampledCompositeCheck.MaxCachedResults"),
+		4096,
+		TEXT("Number of sampled composite check results kept, shared by Check Data and Discard Empty Data Sets nodes. The oldest results are dropped first."));
+
+	/**
+	 * Results of the sampled composite check, keyed on the data UID and the level. UIDs are never reused, so keys can't collide.
+	 * Bounded by dropping the oldest results, kept in insertion order in a ring.
+	 */
+	struct FEmptinessCache
+	{
+		FCriticalSection Lock;
+		TMap<uint64, bool> Results;
+		TArray<uint64> Ring;
+		int32 RingHead = 0;
+		int64 Hits = 0;
+		int64 Misses = 0;
+
+		bool Find(uint64 Key, bool& bOutEmpty)
+		{
+			FScopeLock ScopeLock(&Lock);
+
+			if (const bool* bCachedEmpty = Results.Find(Key))
+			{
+				++Hits;
+				bOutEmpty = *bCachedEmpty;
+				return true;
+			}
+
+			++Misses;
+			return false;
+		}
+
+		void Add(uint64 Key, bool bEmpty)
+		{
+			FScopeLock ScopeLock(&Lock);
+
+			const int32 MaxResults = FMath::Max(CVarMaxCachedResults.GetValueOnAnyThread(), 1);
+			if (Ring.Num() > MaxResults)
+			{
+				Reset_Locked();
+			}
+
+			if (Results.Contains(Key))
+			{
+				return;
+			}
+
+			if (Ring.Num() < MaxResults)
+			{
+				Ring.Add(Key);
+			}
+			else
+			{
+				Results.Remove(Ring[RingHead]);
+				Ring[RingHead] = Key;
+				RingHead = (RingHead + 1) % Ring.Num();
+			}
+
+			Results.Add(Key, bEmpty);
+		}
+
+		void Reset()
+		{
+			FScopeLock ScopeLock(&Lock);
+			Reset_Locked();
+		}
+
+	private:
+		void Reset_Locked()
+		{
+			Results.Empty();
+			Ring.Empty();
+			RingHead = 0;
+		}
+	};
+
+	static FEmptinessCache& GetEmptinessCache()
+	{
+		static FEmptinessCache EmptinessCache;
+		return EmptinessCache;
+	}
+
+	static FAutoConsoleCommand CommandEmptinessCacheStats(
+		TEXT("pcgc.SampledCompositeCheck.CacheStats"),
+		TEXT("Logs the hit and miss counters of the sampled composite check cache."),
+		FConsoleCommandDelegate::CreateLambda([]()
+		{
+			FEmptinessCache& EmptinessCache = GetEmptinessCache();
+			FScopeLock ScopeLock(&EmptinessCache.Lock);
+			UE_LOG(LogPCG, Log, TEXT("Sampled composite check cache: %lld hits, %lld misses, %d entries"), EmptinessCache.Hits, EmptinessCache.Misses, EmptinessCache.Results.Num());
+		}));
+
+	static FAutoConsoleCommand CommandClearEmptinessCache(
+		TEXT("pcgc.SampledCompositeCheck.ClearCache"),
+		TEXT("Empties the sampled composite check cache."),
+		FConsoleCommandDelegate::CreateLambda([]()
+		{
+			GetEmptinessCache().Reset();
+		}));
+
+	/** Samples the cells of a lattice with Resolution cells on each axis of non-zero extent, returns true at the first positive sample. */
+	static bool HasPositiveSample(const UPCGSpatialData* Data, const FBox& Bounds, int32 Resolution)
+	{
+		const FVector Size = Bounds.GetSize();
+		const FIntVector CellCounts(Size.X > 0 ? Resolution : 1, Size.Y > 0 ? Resolution : 1, Size.Z > 0 ? Resolution : 1);
+		const FVector CellSize = Size / FVector(CellCounts);
+		const FBox SampleBounds(-CellSize * 0.5, CellSize * 0.5);
+		const int32 NumSamples = CellCounts.X * CellCounts.Y * CellCounts.Z;
+
+		std::atomic<bool> bFound = false;
+
+		ParallelFor(NumSamples, [Data, &Bounds, &CellCounts, &CellSize, &SampleBounds, &bFound](int32 SampleIndex)
+		{
+			if (bFound.load(std::memory_order_relaxed))
+			{
+				return;
+			}
+
+			const FIntVector Cell(SampleIndex % CellCounts.X, (SampleIndex / CellCounts.X) % CellCounts.Y, SampleIndex / (CellCounts.X * CellCounts.Y));
+			const FVector Center = Bounds.Min + (FVector(Cell) + FVector(0.5)) * CellSize;
+
+			FPCGPoint Point;
+			if (Data->SamplePoint(FTransform(Center), SampleBounds, Point, nullptr) && Point.Density > 0)
+			{
+				bFound.store(true, std::memory_order_relaxed);
+			}
+		});
+
+		return bFound;
+	}
+
+	bool IsCompositeData(const UPCGData* Data)
+	{
+		if (const UPCGCMemoizedSpatialData* MemoizedData = Cast<UPCGCMemoizedSpatialData>(Data))
+		{
+			Data = MemoizedData->GetInnerData();
+		}
+
+		return Cast<UPCGIntersectionData>(Data) || Cast<UPCGDifferenceData>(Data) || Cast<UPCGUnionData>(Data);
+	}
+
+	bool IsCompositeDataEmpty(const UPCGSpatialData* Data, bool bSampled, int32 MaxLevel)
+	{
+		check(Data);
+
+		if (!Data->GetStrictBounds().IsValid)
+		{
+			return true;
+		}
+
+		if (!bSampled)
+		{
+			return false;
+		}
+
+		FEmptinessCache& EmptinessCache = GetEmptinessCache();
+
+		const uint64 Key = (uint64(Data->UID) << 8) | uint64(MaxLevel & 0xFF);
+		bool bCachedEmpty = false;
+		if (EmptinessCache.Find(Key, bCachedEmpty))
+		{
+			return bCachedEmpty;
+		}
+
+		TRACE_CPUPROFILER_EVENT_SCOPE(PCGCDataHelpers::IsCompositeDataEmpty);
+
+		const FBox Bounds = Data->GetBounds();
+		bool bEmpty = true;
+
+		//Coarse to fine, most non-empty data is found on the first levels
+		for (int32 Level = 1; Level <= FMath::Clamp(MaxLevel, 1, 8) && bEmpty; ++Level)
+		{
+			bEmpty = !HasPositiveSample(Data, Bounds, 1 << Level);
+		}
+
+		EmptinessCache.Add(Key, bEmpty);
+
+		return bEmpty;
+	}
+
+	int64 GetNumMetadataEntries(const UPCGData* Data)
+	{
+		if (const UPCGPointData* PointData = Cast<UPCGPointData>(Data))
+		{
+			int64 NumEntries = 0;
+			for (const FPCGPoint& Point : PointData->GetPoints())
+			{
+				NumEntries += Point.MetadataEntry != PCGInvalidEntryKey ? 1 : 0;
+			}
+
+			return NumEntries;
+		}
+
+		const UPCGMetadata* Metadata = Data ? Data->ConstMetadata() : nullptr;
+		return Metadata ? Metadata->GetItemCountForChild() : 0;
+	}
+}
@@ -0,0 +1,316 @@
+// Copyright Roman K. All Rights Reserved. 
+
+#include "PCGCDataStatistics.h"
+
+#include "PCGCDataHelpers.h"
+#include "PCGContext.h"
+#include "Data/PCGSpatialData.h"
+#include "Data/PCGPointData.h"
+#include "PCGParamData.h"
+#include "Metadata/PCGMetadata.h"
+#include "Metadata/PCGMetadataAttribute.h"
+#include "Metadata/Accessors/IPCGAttributeAccessor.h"
+#include "Metadata/Accessors/PCGAttributeAccessorHelpers.h"
+
+#include "Async/ParallelFor.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(PCGCDataStatistics)
+
+#define LOCTEXT_NAMESPACE "PCGCDataStatisticsElement"
+
+namespace PCGCDataStatisticsSettings
+{
+	static const FName StatisticsLabel = TEXT("Statistics");
+	static const FName TotalsLabel = TEXT("Totals");
+}
+
+namespace PCGCDataStatisticsHelpers
+{
+	/** Values are read in chunks through the bulk accessor API, instead of one virtual call per element. */
+	constexpr int32 ChunkSize = 4096;
+
+	struct FAttributeStatistics
+	{
+		double Min = TNumericLimits<double>::Max();
+		double Max = TNumericLimits<double>::Lowest();
+		double Sum = 0.0;
+		int64 Count = 0;
+
+		double GetMean() const { return Count > 0 ? Sum / Count : 0.0; }
+
+		void Merge(const FAttributeStatistics& Other)
+		{
+			Min = FMath::Min(Min, Other.Min);
+			Max = FMath::Max(Max, Other.Max);
+			Sum += Other.Sum;
+			Count += Other.Count;
+		}
+	};
+
+	struct FDataStatistics
+	{
+		int64 NumPoints = 0;
+		int64 NumEntries = 0;
+		FBox Bounds = FBox(EForceInit::ForceInit);
+		TArray<FAttributeStatistics> Attributes;
+	};
+
+	static void ReduceAttribute(const UPCGData* Data, const FPCGAttributePropertyInputSelector& InSelector, FAttributeStatistics& OutStatistics)
+	{
+		const FPCGAttributePropertyInputSelector Selector = InSelector.CopyAndFixLast(Data);
+		TUniquePtr<const IPCGAttributeAccessor> Accessor = PCGAttributeAccessorHelpers::CreateConstAccessor(Data, Selector);
+		TUniquePtr<const IPCGAttributeAccessorKeys> Keys = PCGAttributeAccessorHelpers::CreateConstKeys(Data, Selector);
+
+		if (!Accessor || !Keys)
+		{
+			return;
+		}
+
+		const int32 NumElements = Keys->GetNum();
+		TArray<double> Values;
+		Values.SetNumUninitialized(FMath::Min(ChunkSize, NumElements));
+
+		for (int32 Start = 0; Start < NumElements; Start += ChunkSize)
+		{
+			TArrayView<double> ChunkValues(Values.GetData(), FMath::Min(ChunkSize, NumElements - Start));
+			if (!Accessor->GetRange<double>(ChunkValues, Start, *Keys, EPCGAttributeAccessorFlags::AllowBroadcast))
+			{
+				return;
+			}
+
+			for (double Value : ChunkValues)
+			{
+				if (!FMath::IsNaN(Value))
+				{
+					OutStatistics.Min = FMath::Min(OutStatistics.Min, Value);
+					OutStatistics.Max = FMath::Max(OutStatistics.Max, Value);
+					OutStatistics.Sum += Value;
+					++OutStatistics.Count;
+				}
+			}
+		}
+	}
+
+	static FDataStatistics ComputeStatistics(const UPCGData* Data, const TArray<FPCGAttributePropertyInputSelector>& Selectors)
+	{
+		FDataStatistics Statistics;
+		Statistics.Attributes.SetNum(Selectors.Num());
+
+		if (const UPCGPointData* PointData = Cast<UPCGPointData>(Data))
+		{
+			Statistics.NumPoints = PointData->GetPoints().Num();
+		}
+
+		if (const UPCGSpatialData* SpatialData = Cast<UPCGSpatialData>(Data))
+		{
+			Statistics.Bounds = SpatialData->GetBounds();
+		}
+
+		//Derived data shares the entries of its parent metadata, the local item count alone misses them
+		Statistics.NumEntries = PCGCDataHelpers::GetNumMetadataEntries(Data);
+
+		for (int32 SelectorIndex = 0; SelectorIndex < Selectors.Num(); ++SelectorIndex)
+		{
+			ReduceAttribute(Data, Selectors[SelectorIndex], Statistics.Attributes[SelectorIndex]);
+		}
+
+		return Statistics;
+	}
+
+	/** Column name prefix built from the whole selector, so $Position.X and $Position.Y get distinct columns. */
+	static FString GetColumnPrefix(const FPCGAttributePropertyInputSelector& Selector)
+	{
+		FString Prefix = Selector.GetDisplayText().ToString();
+		Prefix.RemoveFromStart(TEXT("$"));
+		Prefix.RemoveFromStart(TEXT("@"));
+		FPCGMetadataAttributeBase::SanitizeName(Prefix);
+
+		return Prefix;
+	}
+
+	/** One column per statistic, the caller adds one entry per row. */
+	struct FStatisticsColumns
+	{
+		FPCGMetadataAttribute<int64>* NumPoints = nullptr;
+		FPCGMetadataAttribute<int64>* NumEntries = nullptr;
+		FPCGMetadataAttribute<FVector>* BoundsMin = nullptr;
+		FPCGMetadataAttribute<FVector>* BoundsMax = nullptr;
+		TArray<FPCGMetadataAttribute<double>*> Min;
+		TArray<FPCGMetadataAttribute<double>*> Max;
+		TArray<FPCGMetadataAttribute<double>*> Mean;
+
+		/** Selectors whose columns collide with existing ones get no columns, the error is logged when a context is given. */
+		FStatisticsColumns(FPCGContext* Context, UPCGMetadata* Metadata, const TArray<FPCGAttributePropertyInputSelector>& Selectors)
+		{
+			NumPoints = Metadata->CreateAttribute<int64>(TEXT("NumPoints"), 0, /*bAllowsInterpolation=*/false, /*bOverrideParent=*/false);
+			NumEntries = Metadata->CreateAttribute<int64>(TEXT("NumEntries"), 0, /*bAllowsInterpolation=*/false, /*bOverrideParent=*/false);
+			BoundsMin = Metadata->CreateAttribute<FVector>(TEXT("BoundsMin"), FVector::ZeroVector, /*bAllowsInterpolation=*/false, /*bOverrideParent=*/false);
+			BoundsMax = Metadata->CreateAttribute<FVector>(TEXT("BoundsMax"), FVector::ZeroVector, /*bAllowsInterpolation=*/false, /*bOverrideParent=*/false);
+
+			for (const FPCGAttributePropertyInputSelector& Selector : Selectors)
+			{
+				const FString Prefix = GetColumnPrefix(Selector);
+				const FName MinName(Prefix + TEXT("_Min"));
+				const FName MaxName(Prefix + TEXT("_Max"));
+				const FName MeanName(Prefix + TEXT("_Mean"));
+
+				if (Metadata->HasAttribute(MinName) || Metadata->HasAttribute(MaxName) || Metadata->HasAttribute(MeanName))
+				{
+					if (Context)
+					{
+						PCGE_LOG_C(Error, GraphAndLog, Context, FText::Format(LOCTEXT("ColumnNameCollision", "Attribute '{0}' maps to the columns '{1}_*' which are already used by another attribute, its statistics are not written"), Selector.GetDisplayText(), FText::FromString(Prefix)));
+					}
+
+					Min.Add(nullptr);
+					Max.Add(nullptr);
+					Mean.Add(nullptr);
+					continue;
+				}
+
+				Min.Add(Metadata->CreateAttribute<double>(MinName, 0.0, /*bAllowsInterpolation=*/false, /*bOverrideParent=*/false));
+				Max.Add(Metadata->CreateAttribute<double>(MaxName, 0.0, /*bAllowsInterpolation=*/false, /*bOverrideParent=*/false));
+				Mean.Add(Metadata->CreateAttribute<double>(MeanName, 0.0, /*bAllowsInterpolation=*/false, /*bOverrideParent=*/false));
+			}
+		}
+
+		void SetValues(PCGMetadataEntryKey EntryKey, const FDataStatistics& Statistics)
+		{
+			NumPoints->SetValue(EntryKey, Statistics.NumPoints);
+			NumEntries->SetValue(EntryKey, Statistics.NumEntries);
+			BoundsMin->SetValue(EntryKey, Statistics.Bounds.IsValid ? Statistics.Bounds.Min : FVector::ZeroVector);
+			BoundsMax->SetValue(EntryKey, Statistics.Bounds.IsValid ? Statistics.Bounds.Max : FVector::ZeroVector);
+
+			for (int32 Index = 0; Index < Statistics.Attributes.Num(); ++Index)
+			{
+				const FAttributeStatistics& Attribute = Statistics.Attributes[Index];
+
+				//Attributes missing on the data leave the default values
+				if (Attribute.Count > 0 && Min[Index] && Max[Index] && Mean[Index])
+				{
+					Min[Index]->SetValue(EntryKey, Attribute.Min);
+					Max[Index]->SetValue(EntryKey, Attribute.Max);
+					Mean[Index]->SetValue(EntryKey, Attribute.GetMean());
+				}
+			}
+		}
+	};
+}
+
+#if WITH_EDITOR
+FText UPCGCDataStatisticsSettings::GetNodeTooltipText() const
+{
+	return LOCTEXT("NodeTooltip", "Computes point counts, metadata entry counts, bounds and the minimum, maximum and mean of the selected attributes, for every input data and for all of them");
+}
+#endif
+
+FString UPCGCDataStatisticsSettings::GetAdditionalTitleInformation() const
+{
+#if WITH_EDITOR
+	return TEXT("PCG Custom");
+#else
+	return Super::GetAdditionalTitleInformation();
+#endif
+}
+
+TArray<FPCGPinProperties> UPCGCDataStatisticsSettings::InputPinProperties() const
+{
+	TArray<FPCGPinProperties> PinProperties;
+	FPCGPinProperties& InputPinProperty = PinProperties.Emplace_GetRef(PCGPinConstants::DefaultInputLabel, EPCGDataType::Any);
+	InputPinProperty.SetRequiredPin();
+
+	return PinProperties;
+}
+
+TArray<FPCGPinProperties> UPCGCDataStatisticsSettings::OutputPinProperties() const
+{
+	TArray<FPCGPinProperties> PinProperties;
+	PinProperties.Emplace(
+		PCGCDataStatisticsSettings::StatisticsLabel,
+		EPCGDataType::Param,
+		/*bInAllowMultipleConnections=*/true,
+		/*bInAllowMultipleData=*/false,
+		LOCTEXT("OutStatisticsTooltip", "Attribute set with one entry per input data, in input order"));
+
+	PinProperties.Emplace(
+		PCGCDataStatisticsSettings::TotalsLabel,
+		EPCGDataType::Param,
+		/*bInAllowMultipleConnections=*/true,
+		/*bInAllowMultipleData=*/false,
+		LOCTEXT("OutTotalsTooltip", "Attribute set with a single entry, accumulated over all the input data"));
+
+	return PinProperties;
+}
+
+FPCGElementPtr UPCGCDataStatisticsSettings::CreateElement() const
+{
+	return MakeShared<FPCGCDataStatisticsElement>();
+}
+
+bool FPCGCDataStatisticsElement::ExecuteInternal(FPCGContext* Context) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FPCGCDataStatisticsElement::Execute);
+
+	const UPCGCDataStatisticsSettings* Settings = Context->GetInputSettings<UPCGCDataStatisticsSettings>();
+	check(Settings);
+
+	TArray<FPCGTaggedData> Inputs = Context->InputData.GetInputsByPin(PCGPinConstants::DefaultInputLabel);
+	TArray<FPCGTaggedData>& Outputs = Context->OutputData.TaggedData;
+
+	//Every input is reduced on its own, the results are only written to the attribute sets afterwards
+	TArray<PCGCDataStatisticsHelpers::FDataStatistics> Statistics;
+	Statistics.SetNum(Inputs.Num());
+
+	ParallelFor(Inputs.Num(), [&Inputs, &Statistics, Settings](int32 InputIndex)
+	{
+		Statistics[InputIndex] = PCGCDataStatisticsHelpers::ComputeStatistics(Inputs[InputIndex].Data, Settings->Attributes);
+	});
+
+	PCGCDataStatisticsHelpers::FDataStatistics Totals;
+	Totals.Attributes.SetNum(Settings->Attributes.Num());
+
+	UPCGParamData* StatisticsData = NewObject<UPCGParamData>();
+	PCGCDataStatisticsHelpers::FStatisticsColumns StatisticsColumns(Context, StatisticsData->Metadata, Settings->Attributes);
+	FPCGMetadataAttribute<int32>* DataIndexAttribute = StatisticsData->Metadata->CreateAttribute<int32>(TEXT("DataIndex"), -1, /*bAllowsInterpolation=*/false, /*bOverrideParent=*/false);
+
+	for (int32 InputIndex = 0; InputIndex < Statistics.Num(); ++InputIndex)
+	{
+		const PCGCDataStatisticsHelpers::FDataStatistics& InputStatistics = Statistics[InputIndex];
+
+		const PCGMetadataEntryKey EntryKey = StatisticsData->Metadata->AddEntry();
+		DataIndexAttribute->SetValue(EntryKey, InputIndex);
+		StatisticsColumns.SetValues(EntryKey, InputStatistics);
+
+		Totals.NumPoints += InputStatistics.NumPoints;
+		Totals.NumEntries += InputStatistics.NumEntries;
+		if (InputStatistics.Bounds.IsValid)
+		{
+			Totals.Bounds += InputStatistics.Bounds;
+		}
+
+		for (int32 AttributeIndex = 0; AttributeIndex < Totals.Attributes.Num(); ++AttributeIndex)
+		{
+			Totals.Attributes[AttributeIndex].Merge(InputStatistics.Attributes[AttributeIndex]);
+		}
+	}
+
+	FPCGTaggedData& StatisticsOutput = Outputs.Emplace_GetRef();
+	StatisticsOutput.Pin = PCGCDataStatisticsSettings::StatisticsLabel;
+	StatisticsOutput.Data = StatisticsData;
+
+	UPCGParamData* TotalsData = NewObject<UPCGParamData>();
+	//Same column names as the statistics, collisions were already reported
+	PCGCDataStatisticsHelpers::FStatisticsColumns TotalsColumns(/*Context=*/nullptr, TotalsData->Metadata, Settings->Attributes);
+	FPCGMetadataAttribute<int32>* NumDataAttribute = TotalsData->Metadata->CreateAttribute<int32>(TEXT("NumData"), 0, /*bAllowsInterpolation=*/false, /*bOverrideParent=*/false);
+
+	const PCGMetadataEntryKey TotalsEntryKey = TotalsData->Metadata->AddEntry();
+	NumDataAttribute->SetValue(TotalsEntryKey, Inputs.Num());
+	TotalsColumns.SetValues(TotalsEntryKey, Totals);
+
+	FPCGTaggedData& TotalsOutput = Outputs.Emplace_GetRef();
+	TotalsOutput.Pin = PCGCDataStatisticsSettings::TotalsLabel;
+	TotalsOutput.Data = TotalsData;
+
+	return true;
+}
+
+#undef LOCTEXT_NAMESPACE
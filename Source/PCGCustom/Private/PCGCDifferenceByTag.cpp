@@ -4,14 +4,854 @@
 
 #include "Data/PCGSpatialData.h"
 #include "Data/PCGPointData.h"
+#include "Data/PCGUnionData.h"
 #include "PCGContext.h"
+#include "PCGComponent.h"
+#include "PCGModule.h"
 #include "Containers/Set.h"
 #include "Helpers/PCGHelpers.h"
 #include "PCGPin.h"
+#include "Helpers/PCGAsync.h"
+#include "Metadata/PCGMetadata.h"
+#include "PCGCDataCache.h"
+#include "PCGCMemoizedSpatialData.h"
+
+#include "Algo/BinarySearch.h"
+#include "Algo/StableSort.h"
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+#include "Hash/CityHash.h"
+
+#include <algorithm>
 
 
 #define LOCTEXT_NAMESPACE "PCGCDifferenceByTagElement"
 
+namespace PCGCDifferenceByTagHelpers
+{
+	static TAutoConsoleVariable<int32> CVarResultCacheBudgetMB(
+		TEXT("pcgc.DifferenceByTag.ResultCacheBudgetMB"),
+		512,
+		TEXT("Memory budget in MB of the per-input result cache shared by Difference By Actor Tag nodes."));
+
+	/** Converted differences of each source, shared by every Difference By Actor Tag node. */
+	static FPCGCDataCache& GetResultCache()
+	{
+		static FPCGCDataCache ResultCache(TEXT("PCGCDifferenceByTagResultCache"));
+		return ResultCache;
+	}
+
+	static FAutoConsoleCommand CommandResultCacheStats(
+		TEXT("pcgc.DifferenceByTag.ResultCacheStats"),
+		TEXT("Logs the hit and miss counters of the Difference By Actor Tag result cache."),
+		FConsoleCommandDelegate::CreateLambda([]()
+		{
+			const FPCGCDataCacheStats Stats = GetResultCache().GetStats();
+			UE_LOG(LogPCG, Log, TEXT("Difference By Actor Tag result cache: %lld hits, %lld misses, %lld evictions, %d entries, %.2f MB"), Stats.Hits, Stats.Misses, Stats.Evictions, Stats.NumEntries, Stats.MemorySize / (1024.0 * 1024.0));
+		}));
+
+	static FAutoConsoleCommand CommandClearResultCache(
+		TEXT("pcgc.DifferenceByTag.ClearResultCache"),
+		TEXT("Empties the Difference By Actor Tag result cache."),
+		FConsoleCommandDelegate::CreateLambda([]()
+		{
+			GetResultCache().Reset();
+		}));
+
+	/** ID, priority and exclusion of an input, parsed once from its tags. */
+	struct FTaggedInput
+	{
+		const UPCGSpatialData* SpatialData = nullptr;
+
+		/** Only computed when the broadphase is built or the inputs are clipped. */
+		FBox Bounds = FBox(EForceInit::ForceInit);
+
+		int32 Id = INDEX_NONE;
+		int32 Priority = 0;
+		bool bIsExcluded = false;
+		bool bIsOutsidePartition = false;
+		bool bIsPoint = false;
+
+		/** Untagged, non-spatial and excluded inputs are passed through, nothing is subtracted from them. */
+		bool IsSource() const { return Id != INDEX_NONE && !bIsExcluded; }
+
+		/** Sources outside of the partition are still subtracted from, but are never subtracted from other inputs. */
+		bool IsCandidate() const { return IsSource() && !bIsOutsidePartition; }
+	};
+
+	/** Bounding volume hierarchy over the bounds of the candidate inputs, built once per execution. */
+	class FBoundsBVH
+	{
+	public:
+		void Build(TArray<int32>&& InItems, TArray<FBox>&& InItemBounds)
+		{
+			TRACE_CPUPROFILER_EVENT_SCOPE(FPCGCDifferenceByTagElement::Execute::BuildBVH);
+
+			Items = MoveTemp(InItems);
+			ItemBounds = MoveTemp(InItemBounds);
+			Order.SetNumUninitialized(Items.Num());
+			for (int32 Index = 0; Index < Order.Num(); ++Index)
+			{
+				Order[Index] = Index;
+			}
+
+			Nodes.Reset();
+			if (!Items.IsEmpty())
+			{
+				BuildNode(0, Items.Num());
+			}
+		}
+
+		/** Calls Callback with every item whose bounds intersect the box. */
+		template <typename CallbackType>
+		void Query(const FBox& Box, CallbackType&& Callback) const
+		{
+			if (Nodes.IsEmpty())
+			{
+				return;
+			}
+
+			TArray<int32, TInlineAllocator<64>> Stack;
+			Stack.Add(0);
+
+			while (!Stack.IsEmpty())
+			{
+				const FNode& Node = Nodes[Stack.Pop(EAllowShrinking::No)];
+				if (!Node.Bounds.Intersect(Box))
+				{
+					continue;
+				}
+
+				if (Node.Left == INDEX_NONE)
+				{
+					for (int32 Index = Node.First; Index < Node.First + Node.Count; ++Index)
+					{
+						if (ItemBounds[Order[Index]].Intersect(Box))
+						{
+							Callback(Items[Order[Index]]);
+						}
+					}
+				}
+				else
+				{
+					Stack.Add(Node.Left);
+					Stack.Add(Node.Right);
+				}
+			}
+		}
+
+	private:
+		static constexpr int32 MaxLeafSize = 4;
+
+		struct FNode
+		{
+			FBox Bounds = FBox(EForceInit::ForceInit);
+			int32 First = 0;
+			int32 Count = 0;
+			int32 Left = INDEX_NONE;
+			int32 Right = INDEX_NONE;
+		};
+
+		/** Median split on the longest axis of the centers, the range [First, First + Count) of Order is reordered in place. */
+		int32 BuildNode(int32 First, int32 Count)
+		{
+			const int32 NodeIndex = Nodes.AddDefaulted();
+			FBox Bounds(EForceInit::ForceInit);
+			FBox CenterBounds(EForceInit::ForceInit);
+
+			for (int32 Index = First; Index < First + Count; ++Index)
+			{
+				Bounds += ItemBounds[Order[Index]];
+				CenterBounds += ItemBounds[Order[Index]].GetCenter();
+			}
+
+			Nodes[NodeIndex].Bounds = Bounds;
+			Nodes[NodeIndex].First = First;
+			Nodes[NodeIndex].Count = Count;
+
+			if (Count <= MaxLeafSize)
+			{
+				return NodeIndex;
+			}
+
+			const FVector CenterExtent = CenterBounds.GetExtent();
+			const int32 Axis = (CenterExtent.X >= CenterExtent.Y && CenterExtent.X >= CenterExtent.Z) ? 0 : (CenterExtent.Y >= CenterExtent.Z ? 1 : 2);
+			const int32 Half = Count / 2;
+
+			int32* Begin = Order.GetData() + First;
+			std::nth_element(Begin, Begin + Half, Begin + Count, [this, Axis](int32 A, int32 B)
+			{
+				return ItemBounds[A].GetCenter()[Axis] < ItemBounds[B].GetCenter()[Axis];
+			});
+
+			const int32 Left = BuildNode(First, Half);
+			const int32 Right = BuildNode(First + Half, Count - Half);
+			Nodes[NodeIndex].Left = Left;
+			Nodes[NodeIndex].Right = Right;
+
+			return NodeIndex;
+		}
+
+		TArray<FNode> Nodes;
+		TArray<int32> Items;
+		TArray<FBox> ItemBounds;
+		TArray<int32> Order;
+	};
+
+	struct FTagIndex
+	{
+		/** One entry per input, in input order. */
+		TArray<FTaggedInput> Inputs;
+
+		/** Candidate input indices, sorted by descending priority, then by input order. */
+		TArray<int32> Candidates;
+
+		/** Candidate input indices grouped by interned ID, each group sorted like Candidates. */
+		TArray<TArray<int32>> CandidatesById;
+
+		/** Sources outside of the partition, sorted like Candidates. */
+		TArray<int32> ClippedSources;
+
+		/** Broadphase over the bounded candidates, only built when enabled. */
+		FBoundsBVH CandidateBVH;
+
+		/** Candidates without valid bounds, they can overlap anything. */
+		TArray<int32> UnboundedCandidates;
+
+		/** Number of point data among the first N entries of Candidates, at index N. */
+		TArray<int32> NumPointCandidatesBefore;
+
+		bool bHasBroadphase = false;
+
+		/** Whether a candidate with the same ID as the input has a strictly higher priority. */
+		bool HasHigherPrioritySameId(int32 InputIndex) const
+		{
+			const FTaggedInput& Input = Inputs[InputIndex];
+			return Input.Id != INDEX_NONE && !CandidatesById[Input.Id].IsEmpty() && Inputs[CandidatesById[Input.Id][0]].Priority > Input.Priority;
+		}
+
+		/** Number of candidates with a priority strictly higher than the given one, they are the first entries of Candidates. */
+		int32 GetNumHigherPriorityCandidates(int32 Priority) const
+		{
+			return Algo::LowerBoundBy(Candidates, Priority, [this](int32 InputIndex) { return Inputs[InputIndex].Priority; }, TGreater<int32>());
+		}
+
+		/**
+		 * Counts all the candidates that would be subtracted from the input without broadphase, and how many of them are point data.
+		 * The output type only depends on these, the broadphase only narrows down what is actually subtracted.
+		 */
+		void CountHigherPriorityOtherIds(int32 InputIndex, int32& OutNumCandidates, int32& OutNumPointCandidates) const
+		{
+			const FTaggedInput& Input = Inputs[InputIndex];
+			const int32 NumHigherPriorityCandidates = GetNumHigherPriorityCandidates(Input.Priority);
+
+			OutNumCandidates = NumHigherPriorityCandidates;
+			OutNumPointCandidates = NumPointCandidatesBefore[NumHigherPriorityCandidates];
+
+			for (int32 SameIdIndex : CandidatesById[Input.Id])
+			{
+				if (Inputs[SameIdIndex].Priority <= Input.Priority)
+				{
+					break;
+				}
+
+				--OutNumCandidates;
+				OutNumPointCandidates -= Inputs[SameIdIndex].bIsPoint ? 1 : 0;
+			}
+		}
+	};
+
+	/** Sources with bounds outside of ClipBounds, when valid, are not candidates. */
+	static FTagIndex BuildTagIndex(const TArray<FPCGTaggedData>& Inputs, int32 NumCustomTags, const FString& ExcludeTagsString, bool bBuildBroadphase, const FBox& ClipBounds = FBox(EForceInit::ForceInit))
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FPCGCDifferenceByTagElement::Execute::BuildTagIndex);
+
+		const TArray<FString> ExcludeTags = PCGHelpers::GetStringArrayFromCommaSeparatedString(ExcludeTagsString);
+
+		FTagIndex TagIndex;
+		TagIndex.Inputs.SetNum(Inputs.Num());
+
+		TMap<FString, int32> InternedIds;
+		TArray<FString> InputTags;
+
+		for (int32 InputIndex = 0; InputIndex < Inputs.Num(); ++InputIndex)
+		{
+			const FPCGTaggedData& Input = Inputs[InputIndex];
+			FTaggedInput& TaggedInput = TagIndex.Inputs[InputIndex];
+
+			TaggedInput.SpatialData = Cast<UPCGSpatialData>(Input.Data);
+
+			//Not enough tags, or data is not spatial
+			if (Input.Tags.Num() < 2 + NumCustomTags || !TaggedInput.SpatialData)
+			{
+				continue;
+			}
+
+			TaggedInput.bIsPoint = Input.Data->IsA<UPCGPointData>();
+
+			for (const FString& Tag : ExcludeTags)
+			{
+				if (Input.Tags.Contains(Tag))
+				{
+					TaggedInput.bIsExcluded = true;
+					break;
+				}
+			}
+
+			//ID and Priority are the last tags before the custom ones
+			InputTags = Input.Tags.Array();
+			const FString& IdTag = InputTags[InputTags.Num() - 1 - NumCustomTags];
+
+			int32& InternedId = InternedIds.FindOrAdd(IdTag, InternedIds.Num());
+			TaggedInput.Id = InternedId;
+			TaggedInput.Priority = FCString::Atoi(*InputTags[InputTags.Num() - 2 - NumCustomTags]);
+
+			if (TaggedInput.IsSource())
+			{
+				TagIndex.Candidates.Add(InputIndex);
+			}
+		}
+
+		//Bounds are computed once here, so the gathering only reads the index and can run in parallel
+		if (bBuildBroadphase || ClipBounds.IsValid)
+		{
+			for (int32 InputIndex : TagIndex.Candidates)
+			{
+				FTaggedInput& TaggedInput = TagIndex.Inputs[InputIndex];
+				TaggedInput.Bounds = TaggedInput.SpatialData->GetBounds();
+
+				//Unbounded inputs can overlap the partition
+				TaggedInput.bIsOutsidePartition = ClipBounds.IsValid && TaggedInput.Bounds.IsValid && !TaggedInput.Bounds.Intersect(ClipBounds);
+
+				if (TaggedInput.bIsOutsidePartition)
+				{
+					TagIndex.ClippedSources.Add(InputIndex);
+				}
+			}
+
+			TagIndex.Candidates.RemoveAll([&TagIndex](int32 InputIndex) { return TagIndex.Inputs[InputIndex].bIsOutsidePartition; });
+		}
+
+		Algo::StableSortBy(TagIndex.Candidates, [&TagIndex](int32 InputIndex) { return TagIndex.Inputs[InputIndex].Priority; }, TGreater<int32>());
+		Algo::StableSortBy(TagIndex.ClippedSources, [&TagIndex](int32 InputIndex) { return TagIndex.Inputs[InputIndex].Priority; }, TGreater<int32>());
+
+		TagIndex.CandidatesById.SetNum(InternedIds.Num());
+		TagIndex.NumPointCandidatesBefore.SetNumUninitialized(TagIndex.Candidates.Num() + 1);
+		TagIndex.NumPointCandidatesBefore[0] = 0;
+
+		for (int32 CandidateIndex = 0; CandidateIndex < TagIndex.Candidates.Num(); ++CandidateIndex)
+		{
+			const FTaggedInput& Candidate = TagIndex.Inputs[TagIndex.Candidates[CandidateIndex]];
+			TagIndex.CandidatesById[Candidate.Id].Add(TagIndex.Candidates[CandidateIndex]);
+			TagIndex.NumPointCandidatesBefore[CandidateIndex + 1] = TagIndex.NumPointCandidatesBefore[CandidateIndex] + (Candidate.bIsPoint ? 1 : 0);
+		}
+
+		if (bBuildBroadphase)
+		{
+			TArray<int32> BoundedCandidates;
+			TArray<FBox> CandidateBounds;
+
+			for (int32 InputIndex : TagIndex.Candidates)
+			{
+				const FBox& Bounds = TagIndex.Inputs[InputIndex].Bounds;
+				if (Bounds.IsValid)
+				{
+					BoundedCandidates.Add(InputIndex);
+					CandidateBounds.Add(Bounds);
+				}
+				else
+				{
+					TagIndex.UnboundedCandidates.Add(InputIndex);
+				}
+			}
+
+			TagIndex.CandidateBVH.Build(MoveTemp(BoundedCandidates), MoveTemp(CandidateBounds));
+			TagIndex.bHasBroadphase = true;
+		}
+
+		return TagIndex;
+	}
+
+	/**
+	 * Gathers the inputs to subtract from the source: strictly higher priority and a different ID, in input order.
+	 * With the broadphase, only the candidates whose bounds overlap the source are subtracted; the others can't change its points or density.
+	 * Whether the result is converted to points still depends on all of them, see FTagIndex::CountHigherPriorityOtherIds.
+	 */
+	static void GatherDifferences(const FTagIndex& TagIndex, int32 SourceIndex, TArray<int32>& OutDifferences)
+	{
+		const FTaggedInput& Source = TagIndex.Inputs[SourceIndex];
+		const int32 NumHigherPriorityCandidates = TagIndex.GetNumHigherPriorityCandidates(Source.Priority);
+
+		OutDifferences.Reset();
+
+		const FBox& SourceBounds = Source.Bounds;
+
+		if (TagIndex.bHasBroadphase && SourceBounds.IsValid)
+		{
+			auto AddIfDifference = [&TagIndex, &Source, &OutDifferences](int32 InputIndex)
+			{
+				const FTaggedInput& Candidate = TagIndex.Inputs[InputIndex];
+				if (Candidate.Priority > Source.Priority && Candidate.Id != Source.Id)
+				{
+					OutDifferences.Add(InputIndex);
+				}
+			};
+
+			TagIndex.CandidateBVH.Query(SourceBounds, AddIfDifference);
+
+			for (int32 InputIndex : TagIndex.UnboundedCandidates)
+			{
+				AddIfDifference(InputIndex);
+			}
+
+			OutDifferences.Sort();
+			return;
+		}
+
+		for (int32 CandidateIndex = 0; CandidateIndex < NumHigherPriorityCandidates; ++CandidateIndex)
+		{
+			const int32 InputIndex = TagIndex.Candidates[CandidateIndex];
+			if (TagIndex.Inputs[InputIndex].Id != Source.Id)
+			{
+				OutDifferences.Add(InputIndex);
+			}
+		}
+
+		OutDifferences.Sort();
+	}
+
+	/** Everything above a priority level: the point data sets of each level above it, merged in one point data per level, and the union of the other data sets. */
+	struct FCumulativeTier
+	{
+		TArray<const UPCGPointData*> LevelPoints;
+		const UPCGSpatialData* Others = nullptr;
+	};
+
+	/**
+	 * Builds the cumulative tiers, keyed on the number of candidates above the level (see FTagIndex::GetNumHigherPriorityCandidates).
+	 * Each tier extends the previous one with the points of a single level, so every point is copied at most once, whatever the number of levels.
+	 */
+	static TMap<int32, FCumulativeTier> BuildCumulativeTiers(const FTagIndex& TagIndex)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FPCGCDifferenceByTagElement::Execute::BuildCumulativeTiers);
+
+		TMap<int32, FCumulativeTier> Tiers;
+		FCumulativeTier Running;
+
+		const TArray<int32>& Candidates = TagIndex.Candidates;
+		int32 TierStart = 0;
+
+		while (TierStart < Candidates.Num())
+		{
+			const int32 TierPriority = TagIndex.Inputs[Candidates[TierStart]].Priority;
+			int32 TierEnd = TierStart;
+			while (TierEnd < Candidates.Num() && TagIndex.Inputs[Candidates[TierEnd]].Priority == TierPriority)
+			{
+				++TierEnd;
+			}
+
+			if (TierStart > 0)
+			{
+				Tiers.Add(TierStart, Running);
+			}
+
+			//The lowest level is never subtracted from anything
+			if (TierEnd == Candidates.Num())
+			{
+				break;
+			}
+
+			TArray<const UPCGPointData*> TierPoints;
+			TArray<const UPCGSpatialData*> TierOthers;
+
+			if (Running.Others)
+			{
+				TierOthers.Add(Running.Others);
+			}
+
+			for (int32 CandidateIndex = TierStart; CandidateIndex < TierEnd; ++CandidateIndex)
+			{
+				const FTaggedInput& Candidate = TagIndex.Inputs[Candidates[CandidateIndex]];
+				if (Candidate.bIsPoint)
+				{
+					TierPoints.Add(CastChecked<UPCGPointData>(Candidate.SpatialData));
+				}
+				else
+				{
+					TierOthers.Add(Candidate.SpatialData);
+				}
+			}
+
+			//A level with a single point data set is subtracted as is, only several sets are merged
+			if (TierPoints.Num() == 1)
+			{
+				Running.LevelPoints.Add(TierPoints[0]);
+			}
+			else if (TierPoints.Num() > 1)
+			{
+				UPCGPointData* MergedPoints = NewObject<UPCGPointData>();
+				TArray<FPCGPoint>& Points = MergedPoints->GetMutablePoints();
+
+				int32 NumPoints = 0;
+				for (const UPCGPointData* PointData : TierPoints)
+				{
+					NumPoints += PointData->GetPoints().Num();
+				}
+				Points.Reserve(NumPoints);
+
+				for (const UPCGPointData* PointData : TierPoints)
+				{
+					const int32 FirstNewPoint = Points.Num();
+					Points.Append(PointData->GetPoints());
+
+					//The merged data doesn't carry the attributes of the merged sets
+					for (int32 PointIndex = FirstNewPoint; PointIndex < Points.Num(); ++PointIndex)
+					{
+						Points[PointIndex].MetadataEntry = PCGInvalidEntryKey;
+					}
+				}
+
+				Running.LevelPoints.Add(MergedPoints);
+			}
+
+			if (TierOthers.Num() == 1)
+			{
+				Running.Others = TierOthers[0];
+			}
+			else if (TierOthers.Num() > 1)
+			{
+				UPCGUnionData* Union = NewObject<UPCGUnionData>();
+				Union->Initialize(TierOthers[0], TierOthers[1]);
+
+				for (int32 OtherIndex = 2; OtherIndex < TierOthers.Num(); ++OtherIndex)
+				{
+					Union->AddData(TierOthers[OtherIndex]);
+				}
+
+				Running.Others = Union;
+			}
+
+			TierStart = TierEnd;
+		}
+
+		return Tiers;
+	}
+
+	/** Spatial hash over the world bounds of the points subtracted from one source, each point is stored in the cell of its center. */
+	class FPointSpatialHash
+	{
+	public:
+		void Build(const TArray<const UPCGPointData*>& PointDatas)
+		{
+			TRACE_CPUPROFILER_EVENT_SCOPE(FPCGCDifferenceByTagElement::Execute::BuildPointSpatialHash);
+
+			int32 NumPoints = 0;
+			for (const UPCGPointData* PointData : PointDatas)
+			{
+				NumPoints += PointData->GetPoints().Num();
+			}
+
+			Bounds.Reset(NumPoints);
+			Densities.Reset(NumPoints);
+			MaxExtent = FVector::ZeroVector;
+
+			for (const UPCGPointData* PointData : PointDatas)
+			{
+				for (const FPCGPoint& Point : PointData->GetPoints())
+				{
+					const FBox& PointBounds = Bounds.Add_GetRef(Point.GetLocalBounds().TransformBy(Point.Transform));
+					Densities.Add(Point.Density);
+					MaxExtent = MaxExtent.ComponentMax(PointBounds.GetExtent());
+				}
+			}
+
+			//A cell is as large as the largest point, so a query only has to look one cell further than its own bounds
+			CellSize = FMath::Max(2.0 * MaxExtent.GetMax(), 1.0);
+
+			//Counting sort of the points by cell
+			TArray<FIntVector> PointCells;
+			PointCells.SetNumUninitialized(NumPoints);
+			CellRanges.Reset();
+
+			for (int32 Index = 0; Index < NumPoints; ++Index)
+			{
+				PointCells[Index] = GetCell(Bounds[Index].GetCenter());
+				++CellRanges.FindOrAdd(PointCells[Index], FIntPoint(0, 0)).Y;
+			}
+
+			int32 Offset = 0;
+			for (TPair<FIntVector, FIntPoint>& CellRange : CellRanges)
+			{
+				CellRange.Value.X = Offset;
+				Offset += CellRange.Value.Y;
+				CellRange.Value.Y = 0;
+			}
+
+			SortedPoints.SetNumUninitialized(NumPoints);
+			for (int32 Index = 0; Index < NumPoints; ++Index)
+			{
+				FIntPoint& CellRange = CellRanges[PointCells[Index]];
+				SortedPoints[CellRange.X + CellRange.Y++] = Index;
+			}
+		}
+
+		/** Calls Callback with the index of every point whose bounds intersect the box. */
+		template <typename CallbackType>
+		void Query(const FBox& Box, CallbackType&& Callback) const
+		{
+			const FIntVector MinCell = GetCell(Box.Min - MaxExtent);
+			const FIntVector MaxCell = GetCell(Box.Max + MaxExtent);
+
+			auto VisitCell = [this, &Box, &Callback](const FIntPoint& CellRange)
+			{
+				for (int32 Index = CellRange.X; Index < CellRange.X + CellRange.Y; ++Index)
+				{
+					const int32 PointIndex = SortedPoints[Index];
+					if (Bounds[PointIndex].Intersect(Box))
+					{
+						Callback(PointIndex);
+					}
+				}
+			};
+
+			const int64 NumQueryCells = int64(MaxCell.X - MinCell.X + 1) * int64(MaxCell.Y - MinCell.Y + 1) * int64(MaxCell.Z - MinCell.Z + 1);
+
+			//Large boxes visit the occupied cells instead of the whole range
+			if (NumQueryCells > CellRanges.Num())
+			{
+				for (const TPair<FIntVector, FIntPoint>& CellRange : CellRanges)
+				{
+					VisitCell(CellRange.Value);
+				}
+
+				return;
+			}
+
+			for (int32 Z = MinCell.Z; Z <= MaxCell.Z; ++Z)
+			{
+				for (int32 Y = MinCell.Y; Y <= MaxCell.Y; ++Y)
+				{
+					for (int32 X = MinCell.X; X <= MaxCell.X; ++X)
+					{
+						if (const FIntPoint* CellRange = CellRanges.Find(FIntVector(X, Y, Z)))
+						{
+							VisitCell(*CellRange);
+						}
+					}
+				}
+			}
+		}
+
+		TArray<FBox> Bounds;
+		TArray<float> Densities;
+
+	private:
+		FIntVector GetCell(const FVector& Position) const
+		{
+			return FIntVector(
+				FMath::FloorToInt32(Position.X / CellSize),
+				FMath::FloorToInt32(Position.Y / CellSize),
+				FMath::FloorToInt32(Position.Z / CellSize));
+		}
+
+		double CellSize = 1.0;
+		FVector MaxExtent = FVector::ZeroVector;
+
+		/** First index in SortedPoints and number of points of each occupied cell. */
+		TMap<FIntVector, FIntPoint> CellRanges;
+		TArray<int32> SortedPoints;
+	};
+
+	/** Content CRC of an input, computed once per data object. Only point data has a CRC of its content, other data is hashed on its UID by default. */
+	static uint32 GetContentCrc(const UPCGSpatialData* Data)
+	{
+		return Data->GetOrComputeCrc(/*bFullDataCrc=*/Data->IsA<UPCGPointData>()).GetValue();
+	}
+
+	/**
+	 * Key of the converted difference of a source: the content CRCs of the source and of the inputs subtracted from it in order, and the settings changing the result.
+	 * Data rebuilt upstream with the same content gets the same key, so only the sources whose content or overlapping differences changed are recomputed.
+	 * OutCheck hashes the same values independently of the key, hits are verified on it. Content CRCs are 32 bits, data with colliding CRCs is not told apart.
+	 */
+	static uint64 ComputeResultKey(const FTagIndex& TagIndex, int32 SourceIndex, TConstArrayView<int32> DifferenceIndices, const UPCGCDifferenceByTagSettings* Settings, uint64& OutCheck)
+	{
+		TArray<uint32, TInlineAllocator<16>> Values;
+		Values.Add(GetContentCrc(TagIndex.Inputs[SourceIndex].SpatialData));
+
+		for (int32 DifferenceIndex : DifferenceIndices)
+		{
+			Values.Add(GetContentCrc(TagIndex.Inputs[DifferenceIndex].SpatialData));
+		}
+
+		Values.Add(uint32(Settings->DensityFunction));
+		Values.Add(uint32(Settings->Strategy));
+		Values.Add(uint32(Settings->bDiffMetadata));
+		Values.Add(uint32(Settings->bUsePointSpatialHash));
+
+		uint64 Key = 0;
+		for (uint32 Value : Values)
+		{
+			Key = FPCGCDataCache::CombineKey(Key, Value);
+		}
+
+		OutCheck = CityHash64(reinterpret_cast<const char*>(Values.GetData()), Values.Num() * sizeof(uint32));
+		return Key;
+	}
+
+	/** Whether the points can be subtracted through the spatial hash, diffing attributes is only supported by the difference data. */
+	static bool CanSubtractPoints(const TArray<const UPCGSpatialData*, TInlineAllocator<8>>& DifferenceSets, bool bDiffMetadata)
+	{
+		for (const UPCGSpatialData* DifferenceSet : DifferenceSets)
+		{
+			const UPCGPointData* PointData = Cast<UPCGPointData>(DifferenceSet);
+			if (!PointData)
+			{
+				return false;
+			}
+
+			if (bDiffMetadata && PointData->Metadata && PointData->Metadata->GetAttributeCount() > 0)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	/**
+	 * Approximates the difference of the source points and the difference points, with the same density functions as the difference data.
+	 * The density of the differences at a source point is the average of the overlapping points, weighted by their overlap of the source point bounds.
+	 * Unlike the difference data, overlaps are measured on the world bounds and the sets are not sampled one by one, see bUsePointSpatialHash.
+	 */
+	static UPCGPointData* SubtractPoints(FPCGContext* Context, const UPCGPointData* SourcePoints, const TArray<const UPCGPointData*>& DifferencePoints, EPCGDifferenceDensityFunction DensityFunction)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FPCGCDifferenceByTagElement::Execute::SubtractPoints);
+
+		FPointSpatialHash SpatialHash;
+		SpatialHash.Build(DifferencePoints);
+
+		const TArray<FPCGPoint>& Points = SourcePoints->GetPoints();
+
+		UPCGPointData* OutPointData = NewObject<UPCGPointData>();
+		OutPointData->InitializeFromData(SourcePoints);
+		TArray<FPCGPoint>& OutPoints = OutPointData->GetMutablePoints();
+
+		FPCGAsync::AsyncPointProcessing(Context, Points.Num(), OutPoints, [&Points, &SpatialHash, DensityFunction](int32 Index, FPCGPoint& OutPoint)
+		{
+			const FPCGPoint& Point = Points[Index];
+			const FBox PointBounds = Point.GetLocalBounds().TransformBy(Point.Transform);
+			const double PointVolume = PointBounds.GetVolume();
+
+			double SumContributions = 0.0;
+			double SumDensities = 0.0;
+
+			SpatialHash.Query(PointBounds, [&SpatialHash, &PointBounds, PointVolume, &SumContributions, &SumDensities](int32 DifferenceIndex)
+			{
+				//Flat points are either inside or outside of the difference point
+				const double Contribution = PointVolume > UE_DOUBLE_SMALL_NUMBER ? PointBounds.Overlap(SpatialHash.Bounds[DifferenceIndex]).GetVolume() / PointVolume : 1.0;
+				SumContributions += Contribution;
+				SumDensities += Contribution * SpatialHash.Densities[DifferenceIndex];
+			});
+
+			OutPoint = Point;
+
+			if (SumContributions <= 0.0)
+			{
+				return true;
+			}
+
+			const float DifferenceDensity = static_cast<float>(SumContributions > 1.0 ? SumDensities / SumContributions : SumDensities);
+
+			switch (DensityFunction)
+			{
+			case EPCGDifferenceDensityFunction::Binary:
+				OutPoint.Density = DifferenceDensity > 0.0f ? 0.0f : Point.Density;
+				break;
+			case EPCGDifferenceDensityFunction::ClampedSubstraction:
+				OutPoint.Density = FMath::Max(0.0f, Point.Density - DifferenceDensity);
+				break;
+			case EPCGDifferenceDensityFunction::Minimum:
+			default:
+				OutPoint.Density = FMath::Min(Point.Density, 1.0f - DifferenceDensity);
+				break;
+			}
+
+			return OutPoint.Density > 0.0f;
+		});
+
+		return OutPointData;
+	}
+
+	/** Sparse grid of the cells claimed by the point sets, each cell holds the ID that claimed it. */
+	class FClaimGrid
+	{
+	public:
+		/** Claimed by more than one ID, it conflicts with every ID. */
+		static constexpr int32 SharedClaim = -2;
+
+		/** Points covering more cells, like actor bounds or landscapes, only claim the cell of their center. */
+		static constexpr int64 MaxCellsPerPoint = 4096;
+
+		/** Overridden cell sizes bypass the ClampMin of the setting. */
+		static constexpr double MinCellSize = 1.0;
+
+		explicit FClaimGrid(const FVector& CellSize)
+			: InvCellSize(FVector::OneVector / CellSize.ComponentMax(FVector(MinCellSize)))
+		{}
+
+		FIntVector GetCell(const FVector& Position) const
+		{
+			const FVector Scaled = Position * InvCellSize;
+			return FIntVector(FMath::FloorToInt32(Scaled.X), FMath::FloorToInt32(Scaled.Y), FMath::FloorToInt32(Scaled.Z));
+		}
+
+		bool IsClaimedByOtherId(const FIntVector& Cell, int32 Id) const
+		{
+			const int32* ClaimId = Claims.Find(Cell);
+			return ClaimId && *ClaimId != Id;
+		}
+
+		void Claim(const FIntVector& Cell, int32 Id)
+		{
+			int32& ClaimId = Claims.FindOrAdd(Cell, Id);
+			if (ClaimId != Id)
+			{
+				ClaimId = SharedClaim;
+			}
+		}
+
+		/** Claims the cells covered by the point bounds, or only the cell of its center when they cover more than MaxCellsPerPoint. */
+		void ClaimPoint(const FPCGPoint& Point, int32 Id)
+		{
+			const FBox PointBounds = Point.GetLocalBounds().TransformBy(Point.Transform);
+			const FIntVector MinCell = GetCell(PointBounds.Min);
+			const FIntVector MaxCell = GetCell(PointBounds.Max);
+
+			const int64 NumCells = (int64(MaxCell.X) - MinCell.X + 1) * (int64(MaxCell.Y) - MinCell.Y + 1) * (int64(MaxCell.Z) - MinCell.Z + 1);
+			if (NumCells > MaxCellsPerPoint)
+			{
+				Claim(GetCell(Point.Transform.GetLocation()), Id);
+				return;
+			}
+
+			for (int32 Z = MinCell.Z; Z <= MaxCell.Z; ++Z)
+			{
+				for (int32 Y = MinCell.Y; Y <= MaxCell.Y; ++Y)
+				{
+					for (int32 X = MinCell.X; X <= MaxCell.X; ++X)
+					{
+						Claim(FIntVector(X, Y, Z), Id);
+					}
+				}
+			}
+		}
+
+	private:
+		FVector InvCellSize;
+		TMap<FIntVector, int32> Claims;
+	};
+}
+
 #if WITH_EDITOR
 FText UPCGCDifferenceByTagSettings::GetNodeTooltipText() const
 {
@@ -50,13 +890,60 @@ FPCGElementPtr UPCGCDifferenceByTagSettings::CreateElement() const
 	return MakeShared<FPCGCDifferenceByTagElement>();
 }
 
-bool FPCGCDifferenceByTagElement::ExecuteInternal(FPCGContext* Context) const
+namespace PCGCDifferenceByTagHelpers
+{
+	/** Grid bounds of the executing component when it is a partition, otherwise invalid bounds. */
+	static FBox GetClipBounds(const FPCGContext* Context, const UPCGCDifferenceByTagSettings* Settings)
+	{
+		if (Settings->bClipToPartitionBounds)
+		{
+			if (const UPCGComponent* SourceComponent = Context->SourceComponent.Get())
+			{
+				if (SourceComponent->IsLocalComponent())
+				{
+					return SourceComponent->GetGridBounds();
+				}
+			}
+		}
+
+		return FBox(EForceInit::ForceInit);
+	}
+}
+
+FPCGContext* FPCGCDifferenceByTagElement::CreateContext()
+{
+	return new FPCGCDifferenceByTagContext();
+}
+
+bool FPCGCDifferenceByTagElement::ExecuteInternal(FPCGContext* InContext) const
 {
 	TRACE_CPUPROFILER_EVENT_SCOPE(FPCGCDifferenceByTagElement::Execute);
 
+	check(InContext);
+	FPCGCDifferenceByTagContext* Context = static_cast<FPCGCDifferenceByTagContext*>(InContext);
+
 	const UPCGCDifferenceByTagSettings* Settings = Context->GetInputSettings<UPCGCDifferenceByTagSettings>();
 	check(Settings);
 
+	if (Settings->Strategy == EPCGCDifferenceByTagStrategy::ClaimCells)
+	{
+		ClaimCells(Context, Settings);
+		return true;
+	}
+
+	if (!Context->bPreparedDifferences)
+	{
+		PrepareDifferences(Context, Settings);
+		Context->bPreparedDifferences = true;
+	}
+
+	return ConvertDifferences(Context);
+}
+
+void FPCGCDifferenceByTagElement::PrepareDifferences(FPCGCDifferenceByTagContext* Context, const UPCGCDifferenceByTagSettings* Settings) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FPCGCDifferenceByTagElement::Execute::PrepareDifferences);
+
 	//Preparing IO
 	const TArray<FPCGTaggedData> Inputs = Context->InputData.GetInputs();
 	TArray<FPCGTaggedData>& Outputs = Context->OutputData.TaggedData;
@@ -64,119 +951,363 @@ bool FPCGCDifferenceByTagElement::ExecuteInternal(FPCGContext* Context) const
 	//Checking If custom tags are used and getting their number
 	int32 NumCustomTags = Settings->bUsingCustomTags ? Settings->NumCustomTags : 0;
 
-	//For each set
-	for (const FPCGTaggedData& Input : Inputs)
+	PCGCDifferenceByTagHelpers::FTagIndex TagIndex = PCGCDifferenceByTagHelpers::BuildTagIndex(Inputs, NumCustomTags, Settings->ExcludeTags, Settings->bUseBoundsBroadphase, PCGCDifferenceByTagHelpers::GetClipBounds(Context, Settings));
+
+	const bool bUseCumulativeTiers = Settings->Strategy == EPCGCDifferenceByTagStrategy::CumulativeTiers;
+	const TMap<int32, PCGCDifferenceByTagHelpers::FCumulativeTier> CumulativeTiers = bUseCumulativeTiers ? PCGCDifferenceByTagHelpers::BuildCumulativeTiers(TagIndex) : TMap<int32, PCGCDifferenceByTagHelpers::FCumulativeTier>();
+
+	//Sources sharing their ID with a higher priority set can't use the tier, since it would subtract their own ID
+	auto UsesCumulativeTier = [bUseCumulativeTiers, &TagIndex](int32 InputIndex)
+	{
+		return bUseCumulativeTiers && !TagIndex.HasHigherPrioritySameId(InputIndex);
+	};
+
+	//Gathering only reads the index, so it runs in parallel over the inputs
+	TArray<TArray<int32>> InputDifferences;
+	InputDifferences.SetNum(Inputs.Num());
+
+	ParallelFor(Inputs.Num(), [&TagIndex, &InputDifferences, &UsesCumulativeTier](int32 InputIndex)
+	{
+		if (TagIndex.Inputs[InputIndex].IsSource() && !UsesCumulativeTier(InputIndex))
+		{
+			PCGCDifferenceByTagHelpers::GatherDifferences(TagIndex, InputIndex, InputDifferences[InputIndex]);
+		}
+	});
+
+	if (Settings->bMemoizeResults)
+	{
+		PCGCDifferenceByTagHelpers::GetResultCache().SetMemoryBudget(int64(FMath::Max(PCGCDifferenceByTagHelpers::CVarResultCacheBudgetMB.GetValueOnAnyThread(), 0)) * 1024 * 1024);
+	}
+
+	//Difference objects are created here, serially and in input order; only their conversion to points runs in parallel
+	for (int32 InputIndex = 0; InputIndex < Inputs.Num(); ++InputIndex)
 	{
-		const UPCGSpatialData* InputSpatialData = Cast<UPCGSpatialData>(Input.Data);
+		const FPCGTaggedData& Input = Inputs[InputIndex];
+		const PCGCDifferenceByTagHelpers::FTaggedInput& Source = TagIndex.Inputs[InputIndex];
 
-		//Pass set as is, if there are no tags, not enough tags, or data is not spatial
-		if (Input.Tags.IsEmpty() || Input.Tags.Num() < 2 + NumCustomTags || !InputSpatialData) {
+		//Pass set as is, if there are no tags, not enough tags, data is not spatial or it has an excluded tag
+		if (!Source.IsSource()) {
 			Outputs.Add(Input);
 			continue;
 		}
 
-		
-
-		bool bHasPointsInSource = false;
+		bool bHasPointsInSource = Source.bIsPoint;
 		bool bHasPointsInDifferences = false;
+		bool bHasDifferences = false;
+
+		UPCGDifferenceData* DifferenceData = nullptr;
 
-		bHasPointsInSource |= Input.Data->IsA<UPCGPointData>();
+		TArray<const UPCGSpatialData*, TInlineAllocator<8>> DifferenceSets;
 
-		//Extract ID tag and Priority 
-		TArray<FString> InputTags = Input.Tags.Array();
-		
-		const TArray<FString> Tags = PCGHelpers::GetStringArrayFromCommaSeparatedString(Settings->ExcludeTags);
-		
-		if (!Tags.IsEmpty())
+		if (UsesCumulativeTier(InputIndex))
 		{
-			bool bHasCommonTags = false;
-			for (FString Tag : Tags) {
-				if (InputTags.Contains(Tag)) {
-					bHasCommonTags = true;
-					break;
+			if (const PCGCDifferenceByTagHelpers::FCumulativeTier* Tier = CumulativeTiers.Find(TagIndex.GetNumHigherPriorityCandidates(Source.Priority)))
+			{
+				for (const UPCGPointData* LevelPoints : Tier->LevelPoints)
+				{
+					DifferenceSets.Add(LevelPoints);
+					bHasPointsInDifferences = true;
 				}
-			}
-			if (bHasCommonTags) {
-				Outputs.Add(Input);
-				continue;
+
+				if (Tier->Others)
+				{
+					DifferenceSets.Add(Tier->Others);
+				}
+
+				//A tier holding only non-point sets still has differences to subtract
+				bHasDifferences = !DifferenceSets.IsEmpty();
 			}
 		}
+		else
+		{
+			//Decided over every higher priority set, like without broadphase, so the broadphase never changes the output type
+			int32 NumHigherPriorityDifferences = 0;
+			int32 NumHigherPriorityPointDifferences = 0;
+			TagIndex.CountHigherPriorityOtherIds(InputIndex, NumHigherPriorityDifferences, NumHigherPriorityPointDifferences);
 
-		FString IdTag = InputTags[InputTags.Num() - 1 - NumCustomTags];
-		int32 DataSetPriority = FCString::Atoi(*InputTags[(InputTags.Num()-2 - NumCustomTags)]);
+			bHasDifferences = NumHigherPriorityDifferences > 0;
+			bHasPointsInDifferences = NumHigherPriorityPointDifferences > 0;
 
-		UPCGDifferenceData* DifferenceData = nullptr;
-		
+			for (int32 DifferenceIndex : InputDifferences[InputIndex])
+			{
+				DifferenceSets.Add(TagIndex.Inputs[DifferenceIndex].SpatialData);
+			}
+		}
+
+		if (!bHasDifferences) {
 
-		for (const FPCGTaggedData& InputInner : Inputs) {
+			Outputs.Add(Input);
+			continue;
+		}
 
-			const UPCGSpatialData* InputInnerSpatialData = Cast<UPCGSpatialData>(InputInner.Data);
+		const bool bConvertToPoints = Settings->Mode == EPCGDifferenceMode::Discrete ||
+			(Settings->Mode == EPCGDifferenceMode::Inferred && bHasPointsInSource && bHasPointsInDifferences);
 
-			//Pass this set, if there are no tags, not enough tags, or data is not spatial
-			if (InputInner.Tags.IsEmpty() || InputInner.Tags.Num() < 2 + NumCustomTags || !InputInnerSpatialData) {
-				continue;
-			}
+		//None of the differences overlap the source: it is unchanged, and only has to be converted when the mode requires points
+		if (DifferenceSets.IsEmpty())
+		{
+			FPCGTaggedData& Output = Outputs.Add_GetRef(Input);
 
-			TArray<FString> InputInnerTags = InputInner.Tags.Array();
-			
-			if (!Tags.IsEmpty())
+			if (bConvertToPoints && !bHasPointsInSource)
 			{
-				bool bHasCommonTags = false;
-				for (FString Tag : Tags) {
-					if (InputInnerTags.Contains(Tag)) {
-						bHasCommonTags = true;
-						break;
-					}
-				}
-				if (bHasCommonTags) {
-					continue;
-				}
+				FPCGCDifferenceByTagConversion& Conversion = Context->PendingConversions.Emplace_GetRef();
+				Conversion.OutputIndex = Outputs.Num() - 1;
 			}
 
-			if (IdTag != InputInnerTags[InputInnerTags.Num() - 1 - NumCustomTags]) {
-				if (DataSetPriority < FCString::Atoi(*InputInnerTags[(InputInnerTags.Num() - 2 - NumCustomTags)]))
-				{
-					bHasPointsInDifferences |= InputInner.Data->IsA<UPCGPointData>();
+			continue;
+		}
 
-					if (!DifferenceData) {
+		//Only the converted results are memoized, the continuous differences are cheap to build
+		uint64 ResultKey = 0;
+		uint64 ResultCheck = 0;
+		const bool bMemoizeResult = bConvertToPoints && Settings->bMemoizeResults;
 
-						DifferenceData = NewObject<UPCGDifferenceData>();
-						DifferenceData->Initialize(InputSpatialData);
+		if (bMemoizeResult)
+		{
+			const TConstArrayView<int32> DifferenceIndices = UsesCumulativeTier(InputIndex)
+				? MakeArrayView(TagIndex.Candidates.GetData(), TagIndex.GetNumHigherPriorityCandidates(Source.Priority))
+				: MakeArrayView(InputDifferences[InputIndex]);
 
-						DifferenceData->AddDifference(InputInnerSpatialData);
-					}
-					else {
+			ResultKey = PCGCDifferenceByTagHelpers::ComputeResultKey(TagIndex, InputIndex, DifferenceIndices, Settings, ResultCheck);
 
-						DifferenceData->AddDifference(InputInnerSpatialData);
-					}
-				}
+			if (const UPCGData* CachedResult = PCGCDifferenceByTagHelpers::GetResultCache().Find(ResultKey, ResultCheck))
+			{
+				FPCGTaggedData& Output = Outputs.Add_GetRef(Input);
+				Output.Data = CachedResult;
+				++Context->NumReusedResults;
+				continue;
 			}
 		}
 
-		if (!DifferenceData) {
+		for (const UPCGSpatialData* DifferenceSet : DifferenceSets)
+		{
+			if (!DifferenceData) {
 
-			Outputs.Add(Input);
-			continue;
+				DifferenceData = NewObject<UPCGDifferenceData>();
+				DifferenceData->Initialize(Source.SpatialData);
+			}
+
+			DifferenceData->AddDifference(DifferenceSet);
 		}
 
 		FPCGTaggedData& Output = Outputs.Add_GetRef(Input);
 		Output.Data = DifferenceData;
 
-		if (DifferenceData &&
-			(Settings->Mode == EPCGDifferenceMode::Discrete ||
-			(Settings->Mode == EPCGDifferenceMode::Inferred && bHasPointsInSource && bHasPointsInDifferences)))
+		if (!bConvertToPoints && Settings->bMemoizeSampling)
+		{
+			UPCGCMemoizedSpatialData* MemoizedData = NewObject<UPCGCMemoizedSpatialData>();
+			MemoizedData->Initialize(DifferenceData, Settings->SamplingQuantization, Settings->SamplingCacheMaxEntries);
+			Output.Data = MemoizedData;
+		}
+
+		if (bConvertToPoints)
 		{
 
 			DifferenceData->SetDensityFunction(Settings->DensityFunction);
 			DifferenceData->bDiffMetadata = Settings->bDiffMetadata;
-			Output.Data = DifferenceData->ToPointData(Context);
+
+			//Converted later, the difference data stays referenced by the output until then
+			FPCGCDifferenceByTagConversion& Conversion = Context->PendingConversions.Emplace_GetRef();
+			Conversion.OutputIndex = Outputs.Num() - 1;
+			Conversion.ResultKey = ResultKey;
+			Conversion.ResultCheck = ResultCheck;
+			Conversion.bMemoizeResult = bMemoizeResult;
+
+			if (Settings->bUsePointSpatialHash && bHasPointsInSource && PCGCDifferenceByTagHelpers::CanSubtractPoints(DifferenceSets, Settings->bDiffMetadata))
+			{
+				Conversion.SourcePoints = CastChecked<UPCGPointData>(Source.SpatialData);
+				for (const UPCGSpatialData* DifferenceSet : DifferenceSets)
+				{
+					Conversion.DifferencePoints.Add(CastChecked<UPCGPointData>(DifferenceSet));
+				}
+			}
+		}
+	}
+}
+
+bool FPCGCDifferenceByTagElement::ConvertDifferences(FPCGCDifferenceByTagContext* Context) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FPCGCDifferenceByTagElement::Execute::ConvertDifferences);
+
+	const UPCGCDifferenceByTagSettings* Settings = Context->GetInputSettings<UPCGCDifferenceByTagSettings>();
+	check(Settings);
+
+	TArray<FPCGTaggedData>& Outputs = Context->OutputData.TaggedData;
+	const TArray<FPCGCDifferenceByTagConversion>& PendingConversions = Context->PendingConversions;
+	const EPCGDifferenceDensityFunction DensityFunction = Settings->DensityFunction;
+
+	auto Convert = [&Outputs, DensityFunction](FPCGContext* ConversionContext, const FPCGCDifferenceByTagConversion& Conversion)
+	{
+		FPCGTaggedData& Output = Outputs[Conversion.OutputIndex];
+
+		if (Conversion.SourcePoints)
+		{
+			//The difference data is only replaced here, so the merged points of the tiers stay referenced until then
+			Output.Data = PCGCDifferenceByTagHelpers::SubtractPoints(ConversionContext, Conversion.SourcePoints, Conversion.DifferencePoints, DensityFunction);
+		}
+		else
+		{
+			//Either the difference data, or a source without any overlapping difference
+			Output.Data = CastChecked<UPCGSpatialData>(Output.Data)->ToPointData(ConversionContext);
+		}
+
+		if (Conversion.bMemoizeResult)
+		{
+			PCGCDifferenceByTagHelpers::GetResultCache().Add(Conversion.ResultKey, Output.Data, Conversion.ResultCheck);
+		}
+	};
+
+	//One conversion per available task per slice, so the work spreads across frames when few tasks are available
+	const int32 BatchSize = FMath::Max(1, Context->AsyncState.NumAvailableTasks);
+
+	while (Context->NumConvertedDifferences < PendingConversions.Num())
+	{
+		const int32 FirstConversion = Context->NumConvertedDifferences;
+		const int32 NumConversions = FMath::Min(BatchSize, PendingConversions.Num() - FirstConversion);
+
+		if (NumConversions == 1)
+		{
+			//A single conversion keeps the context, so it can parallelize internally
+			Convert(Context, PendingConversions[FirstConversion]);
 		}
+		else
+		{
+			//Each output is written by a single task and the outputs array is not resized, so the order is preserved.
+			//Conversions run without context, single-threaded each, the parallelism is across the conversions.
+			ParallelFor(NumConversions, [&Convert, &PendingConversions, FirstConversion](int32 BatchIndex)
+			{
+				Convert(nullptr, PendingConversions[FirstConversion + BatchIndex]);
+			});
+		}
+
+		Context->NumConvertedDifferences += NumConversions;
+
+		if (Context->NumConvertedDifferences < PendingConversions.Num() && Context->ShouldStop())
+		{
+			return false;
+		}
+	}
 
+	if (Settings->bMemoizeResults)
+	{
+		const int32 NumRecomputedResults = PendingConversions.FilterByPredicate([](const FPCGCDifferenceByTagConversion& Conversion) { return Conversion.bMemoizeResult; }).Num();
+		PCGE_LOG(Verbose, LogOnly, FText::Format(LOCTEXT("ResultCacheInfo", "Result cache: {0} results reused, {1} recomputed"), Context->NumReusedResults, NumRecomputedResults));
 	}
 
 	return true;
+}
+
+void FPCGCDifferenceByTagElement::ClaimCells(FPCGCDifferenceByTagContext* Context, const UPCGCDifferenceByTagSettings* Settings) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FPCGCDifferenceByTagElement::Execute::ClaimCells);
+
+	//Preparing IO
+	const TArray<FPCGTaggedData> Inputs = Context->InputData.GetInputs();
+	TArray<FPCGTaggedData>& Outputs = Context->OutputData.TaggedData;
+
+	//Checking If custom tags are used and getting their number
+	int32 NumCustomTags = Settings->bUsingCustomTags ? Settings->NumCustomTags : 0;
+
+	const PCGCDifferenceByTagHelpers::FTagIndex TagIndex = PCGCDifferenceByTagHelpers::BuildTagIndex(Inputs, NumCustomTags, Settings->ExcludeTags, /*bBuildBroadphase=*/false, PCGCDifferenceByTagHelpers::GetClipBounds(Context, Settings));
+
+	//Everything is passed as is, then the point sets are replaced by their filtered points
+	Outputs = Inputs;
+
+	PCGCDifferenceByTagHelpers::FClaimGrid ClaimGrid(Settings->ClaimCellSize);
+
+	//Replaces the output of a point set by its points whose cell isn't claimed by another ID
+	auto FilterPoints = [Context, &Outputs, &TagIndex, &ClaimGrid](int32 InputIndex) -> const UPCGPointData*
+	{
+		const PCGCDifferenceByTagHelpers::FTaggedInput& Source = TagIndex.Inputs[InputIndex];
+		if (!Source.bIsPoint)
+		{
+			return nullptr;
+		}
+
+		const UPCGPointData* SourcePoints = CastChecked<UPCGPointData>(Source.SpatialData);
+		const TArray<FPCGPoint>& Points = SourcePoints->GetPoints();
+
+		UPCGPointData* OutPointData = NewObject<UPCGPointData>();
+		OutPointData->InitializeFromData(SourcePoints);
+
+		FPCGAsync::AsyncPointProcessing(Context, Points.Num(), OutPointData->GetMutablePoints(), [&Points, &ClaimGrid, &Source](int32 Index, FPCGPoint& OutPoint)
+		{
+			const FPCGPoint& Point = Points[Index];
+			if (ClaimGrid.IsClaimedByOtherId(ClaimGrid.GetCell(Point.Transform.GetLocation()), Source.Id))
+			{
+				return false;
+			}
+
+			OutPoint = Point;
+			return true;
+		});
+
+		Outputs[InputIndex].Data = OutPointData;
+		return OutPointData;
+	};
+
+	const TArray<int32>& Candidates = TagIndex.Candidates;
+
+	//Sources outside of the partition don't claim anything, they are filtered once the grid holds the claims of every level above them
+	const TArray<int32>& ClippedSources = TagIndex.ClippedSources;
+	int32 NextClippedSource = 0;
+
+	auto FilterClippedSources = [&FilterPoints, &TagIndex, &ClippedSources, &NextClippedSource](int32 MinPriority)
+	{
+		while (NextClippedSource < ClippedSources.Num() && TagIndex.Inputs[ClippedSources[NextClippedSource]].Priority >= MinPriority)
+		{
+			FilterPoints(ClippedSources[NextClippedSource++]);
+		}
+	};
+
+	int32 TierStart = 0;
+
+	while (TierStart < Candidates.Num())
+	{
+		const int32 TierPriority = TagIndex.Inputs[Candidates[TierStart]].Priority;
+		int32 TierEnd = TierStart;
+		while (TierEnd < Candidates.Num() && TagIndex.Inputs[Candidates[TierEnd]].Priority == TierPriority)
+		{
+			++TierEnd;
+		}
+
+		//The grid holds the claims of the levels above this one, which are the levels above the clipped sources down to this priority
+		FilterClippedSources(TierPriority);
+
+		TArray<const UPCGPointData*> TierOutputs;
+		TierOutputs.SetNumZeroed(TierEnd - TierStart);
+
+		//Sets of the same priority only test the claims of the levels above, so they can't remove each other
+		for (int32 CandidateIndex = TierStart; CandidateIndex < TierEnd; ++CandidateIndex)
+		{
+			TierOutputs[CandidateIndex - TierStart] = FilterPoints(Candidates[CandidateIndex]);
+		}
+
+		//The lowest level doesn't need to claim anything, unless clipped sources are below it
+		if (TierEnd < Candidates.Num() || NextClippedSource < ClippedSources.Num())
+		{
+			for (int32 CandidateIndex = TierStart; CandidateIndex < TierEnd; ++CandidateIndex)
+			{
+				const UPCGPointData* OutPointData = TierOutputs[CandidateIndex - TierStart];
+				if (!OutPointData)
+				{
+					continue;
+				}
+
+				const int32 Id = TagIndex.Inputs[Candidates[CandidateIndex]].Id;
+
+				for (const FPCGPoint& Point : OutPointData->GetPoints())
+				{
+					ClaimGrid.ClaimPoint(Point, Id);
+				}
+			}
+		}
+
+		TierStart = TierEnd;
+	}
 
+	FilterClippedSources(MIN_int32);
 }
 
 
-#undef LOCTEXT_NAMESPACE
\ No newline at end of file
+#undef LOCTEXT_NAMESPACE
@@ -6,18 +6,258 @@
 #include "Data/PCGSpatialData.h"
 #include "Data/PCGPointData.h"
 #include "PCGParamData.h"
-#include "Data/PCGIntersectionData.h"
-#include "Data/PCGDifferenceData.h"
-#include "Data/PCGUnionData.h"
+#include "Metadata/PCGMetadata.h"
+#include "PCGCDataHelpers.h"
+#include "PCGCDataCache.h"
+
+#include "Algo/StableSort.h"
+#include "Async/ParallelFor.h"
+#include "Serialization/ArchiveCrc32.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(PCGCDiscardData)
 
 #define LOCTEXT_NAMESPACE "PCGCDiscardDataElement"
 
+namespace PCGCDiscardDataHelpers
+{
+	/** Includes the entries inherited from parent metadata, data initialized from another data shares its entries. */
+	static int64 GetNumEntries(const UPCGData* Data)
+	{
+		if (Data && (Data->IsA<UPCGPointData>() || Data->IsA<UPCGParamData>()))
+		{
+			return PCGCDataHelpers::GetNumMetadataEntries(Data);
+		}
+
+		return 0;
+	}
+
+	/** Only reads the counters and bounds already on the data, nothing is converted to points. */
+	static double GetSize(const UPCGData* Data, EPCGCDiscardDataSizeMetric SizeMetric)
+	{
+		switch (SizeMetric)
+		{
+		case EPCGCDiscardDataSizeMetric::PointCount:
+		{
+			const UPCGPointData* PointData = Cast<UPCGPointData>(Data);
+			return PointData ? PointData->GetPoints().Num() : 0;
+		}
+		case EPCGCDiscardDataSizeMetric::EntryCount:
+			return GetNumEntries(Data);
+		case EPCGCDiscardDataSizeMetric::BoundsVolume:
+		default:
+		{
+			const UPCGSpatialData* SpatialData = Cast<UPCGSpatialData>(Data);
+			const FBox Bounds = SpatialData ? SpatialData->GetBounds() : FBox(EForceInit::ForceInit);
+			return Bounds.IsValid ? Bounds.GetVolume() : 0.0;
+		}
+		}
+	}
+
+	static bool IsBelowThresholds(const UPCGData* Data, const UPCGCDiscardDataSettings* Settings)
+	{
+		if (Settings->bUseMinPoints && Data && Data->IsA<UPCGPointData>() && GetSize(Data, EPCGCDiscardDataSizeMetric::PointCount) < Settings->MinPoints)
+		{
+			return true;
+		}
+
+		if (Settings->bUseMinEntries && Data && (Data->IsA<UPCGPointData>() || Data->IsA<UPCGParamData>()) && GetNumEntries(Data) < Settings->MinEntries)
+		{
+			return true;
+		}
+
+		if (Settings->bUseMinBoundsVolume && Data && Data->IsA<UPCGSpatialData>() && GetSize(Data, EPCGCDiscardDataSizeMetric::BoundsVolume) < Settings->MinBoundsVolume)
+		{
+			return true;
+		}
+
+		return false;
+	}
+
+	/** Keeps the K largest outputs, ties keep the earlier input, and the kept outputs stay in input order. */
+	static void KeepLargest(TArray<FPCGTaggedData>& Outputs, int32 Count, EPCGCDiscardDataSizeMetric SizeMetric)
+	{
+		if (Outputs.Num() <= Count)
+		{
+			return;
+		}
+
+		TArray<int32> Order;
+		TArray<double> Sizes;
+		Order.SetNumUninitialized(Outputs.Num());
+		Sizes.SetNumUninitialized(Outputs.Num());
+
+		for (int32 OutputIndex = 0; OutputIndex < Outputs.Num(); ++OutputIndex)
+		{
+			Order[OutputIndex] = OutputIndex;
+			Sizes[OutputIndex] = GetSize(Outputs[OutputIndex].Data, SizeMetric);
+		}
+
+		Algo::StableSortBy(Order, [&Sizes](int32 OutputIndex) { return Sizes[OutputIndex]; }, TGreater<double>());
+
+		TArray<bool> bKeep;
+		bKeep.SetNumZeroed(Outputs.Num());
+		for (int32 Rank = 0; Rank < FMath::Max(Count, 0); ++Rank)
+		{
+			bKeep[Order[Rank]] = true;
+		}
+
+		int32 WriteIndex = 0;
+		for (int32 OutputIndex = 0; OutputIndex < Outputs.Num(); ++OutputIndex)
+		{
+			if (bKeep[OutputIndex])
+			{
+				if (WriteIndex != OutputIndex)
+				{
+					Outputs[WriteIndex] = MoveTemp(Outputs[OutputIndex]);
+				}
+
+				++WriteIndex;
+			}
+		}
+
+		Outputs.SetNum(WriteIndex);
+	}
+
+	/** CRC archive that also records the hashed bytes, so two data with the same CRC can be compared on the same content. */
+	class FContentArchive : public FArchiveCrc32
+	{
+	public:
+		TArray<uint8> Bytes;
+
+		virtual void Serialize(void* Data, int64 Num) override
+		{
+			FArchiveCrc32::Serialize(Data, Num);
+			Bytes.Append(static_cast<const uint8*>(Data), Num);
+		}
+	};
+
+	static TArray<uint8> GetContentBytes(const UPCGData* Data)
+	{
+		const bool bFullDataCrc = Data->IsA<UPCGPointData>() || Data->IsA<UPCGParamData>();
+
+		FContentArchive Ar;
+		Data->AddToCrc(Ar, bFullDataCrc);
+		return MoveTemp(Ar.Bytes);
+	}
+
+	/**
+	 * Removes the data already present earlier in the outputs, keeping the first occurrence and its tags.
+	 * Identical objects are removed without hashing, the others are grouped on their content CRC, class and element count,
+	 * and only discarded when their hashed content is byte for byte equal to an earlier data of the group, so a CRC collision keeps both.
+	 */
+	static void RemoveDuplicates(TArray<FPCGTaggedData>& Outputs)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FPCGCDiscardDataElement::Execute::RemoveDuplicates);
+
+		TSet<const UPCGData*> SeenData;
+		TArray<const UPCGData*> UniqueData;
+		TArray<bool> bIsDuplicate;
+		bIsDuplicate.SetNumZeroed(Outputs.Num());
+
+		for (int32 OutputIndex = 0; OutputIndex < Outputs.Num(); ++OutputIndex)
+		{
+			bool bAlreadySeen = false;
+			SeenData.Add(Outputs[OutputIndex].Data, &bAlreadySeen);
+			bIsDuplicate[OutputIndex] = bAlreadySeen;
+
+			if (!bAlreadySeen && Outputs[OutputIndex].Data)
+			{
+				UniqueData.Add(Outputs[OutputIndex].Data);
+			}
+		}
+
+		//Only points and attribute sets have a content CRC worth the full computation, other data is hashed on its parameters
+		TArray<uint64> ContentKeys;
+		ContentKeys.SetNumUninitialized(UniqueData.Num());
+
+		ParallelFor(UniqueData.Num(), [&UniqueData, &ContentKeys](int32 DataIndex)
+		{
+			const UPCGData* Data = UniqueData[DataIndex];
+			int64 NumElements = 0;
+
+			if (const UPCGPointData* PointData = Cast<UPCGPointData>(Data))
+			{
+				NumElements = PointData->GetPoints().Num();
+			}
+			else if (Data->IsA<UPCGParamData>())
+			{
+				NumElements = GetNumEntries(Data);
+			}
+
+			const bool bFullDataCrc = Data->IsA<UPCGPointData>() || Data->IsA<UPCGParamData>();
+			uint64 Key = FPCGCDataCache::CombineKey(Data->GetOrComputeCrc(bFullDataCrc).GetValue(), uint64(NumElements));
+			ContentKeys[DataIndex] = FPCGCDataCache::CombineKey(Key, uint64(UPTRINT(Data->GetClass())));
+		});
+
+		TMap<const UPCGData*, uint64> KeyByData;
+		KeyByData.Reserve(UniqueData.Num());
+		for (int32 DataIndex = 0; DataIndex < UniqueData.Num(); ++DataIndex)
+		{
+			KeyByData.Add(UniqueData[DataIndex], ContentKeys[DataIndex]);
+		}
+
+		//Content is only serialized for data whose key matches an earlier one, and at most once per data
+		TMap<uint64, TArray<const UPCGData*>> KeptByKey;
+		TMap<const UPCGData*, TArray<uint8>> ContentByData;
+		auto HasSameContent = [&ContentByData](const UPCGData* A, const UPCGData* B)
+		{
+			//Both are added before taking references, adding to the map can move its values
+			for (const UPCGData* Data : { A, B })
+			{
+				if (!ContentByData.Contains(Data))
+				{
+					ContentByData.Add(Data, GetContentBytes(Data));
+				}
+			}
+
+			return ContentByData.FindChecked(A) == ContentByData.FindChecked(B);
+		};
+
+		int32 WriteIndex = 0;
+
+		for (int32 OutputIndex = 0; OutputIndex < Outputs.Num(); ++OutputIndex)
+		{
+			const UPCGData* Data = Outputs[OutputIndex].Data;
+			if (!bIsDuplicate[OutputIndex] && Data)
+			{
+				TArray<const UPCGData*>& Kept = KeptByKey.FindOrAdd(KeyByData[Data]);
+				for (const UPCGData* KeptData : Kept)
+				{
+					if (KeptData->GetClass() == Data->GetClass() && HasSameContent(KeptData, Data))
+					{
+						bIsDuplicate[OutputIndex] = true;
+						break;
+					}
+				}
+
+				if (!bIsDuplicate[OutputIndex])
+				{
+					Kept.Add(Data);
+				}
+			}
+
+			if (!bIsDuplicate[OutputIndex])
+			{
+				if (WriteIndex != OutputIndex)
+				{
+					Outputs[WriteIndex] = MoveTemp(Outputs[OutputIndex]);
+				}
+
+				++WriteIndex;
+			}
+		}
+
+		Outputs.SetNum(WriteIndex);
+	}
+}
+
 #if WITH_EDITOR
 FText UPCGCDiscardDataSettings::GetNodeTooltipText() const
 {
-	return LOCTEXT("NodeTooltip", "Discards data sets with no Points, no Attribute Entries, no Composite Data (Intersection, Difference, Union). Other data types will be passed through as is");
+	return LOCTEXT("NodeTooltip", "Discards data sets with no Points, no Attribute Entries, no Composite Data (Intersection, Difference, Union). Other data types will be passed through as is.\n"
+		"Optionally also discards data sets below the point count, metadata entry count or bounds volume thresholds, keeps only the largest data sets, "
+		"and discards data sets identical in content to an earlier input.\n"
+		"Entries are counted per point for point data: points without a metadata entry don't count, so Min Entries discards point data whose points have no entries.");
 }
 
 EPCGChangeType UPCGCDiscardDataSettings::GetChangeTypeForProperty(const FName& InPropertyName) const
@@ -83,10 +323,10 @@ bool FPCGCDiscardDataElement::ExecuteInternal(FPCGContext* Context) const
 				Outputs.Add(Input);
 			}
 		}
-		else if (Cast<UPCGIntersectionData>(Input.Data.Get()) || Cast<UPCGDifferenceData>(Input.Data.Get()) || Cast<UPCGUnionData>(Input.Data.Get()))
+		else if (PCGCDataHelpers::IsCompositeData(Input.Data.Get()))
 		{	
 			const UPCGSpatialData* IntData = Cast<UPCGSpatialData>(Input.Data.Get());
-			if (IntData->GetStrictBounds().IsValid) 
+			if (!PCGCDataHelpers::IsCompositeDataEmpty(IntData, Settings->bSampledCompositeCheck, Settings->SampledCheckMaxLevel)) 
 			{
 				Outputs.Add(Input);	
 			}	
@@ -96,6 +336,19 @@ bool FPCGCDiscardDataElement::ExecuteInternal(FPCGContext* Context) const
 		}		
 	}
 
+	Outputs.RemoveAll([Settings](const FPCGTaggedData& Output) { return PCGCDiscardDataHelpers::IsBelowThresholds(Output.Data, Settings); });
+
+	if (Settings->bDiscardDuplicates)
+	{
+		PCGCDiscardDataHelpers::RemoveDuplicates(Outputs);
+	}
+
+	//After the duplicates, so they don't take the place of other data sets
+	if (Settings->bKeepLargest)
+	{
+		PCGCDiscardDataHelpers::KeepLargest(Outputs, Settings->KeepLargestCount, Settings->SizeMetric);
+	}
+
 	return true;
 }
 
@@ -2,6 +2,8 @@
 
 
 #include "PCGCGetActorDataExtended.h"
+#include "PCGCActorIndexSubsystem.h"
+#include "PCGCDataCache.h"
 
 #include "PCGActorAndComponentMapping.h"
 #include "PCGComponent.h"
@@ -18,12 +20,27 @@
 #include "Grid/PCGPartitionActor.h"
 
 #include "Algo/AnyOf.h"
+#include "Algo/Transform.h"
+#include "Async/ParallelFor.h"
 #include "GameFramework/Actor.h"
+#include "HAL/IConsoleManager.h"
 #include "UObject/Package.h"
 #include "Internationalization/Text.h"
 
 #include "Metadata/Accessors/PCGAttributeAccessorHelpers.h"
+#include "Metadata/Accessors/PCGAttributeAccessorKeys.h"
+#include "Metadata/Accessors/IPCGAttributeAccessor.h"
+#include "Metadata/PCGMetadataAttributeTpl.h"
 #include "Components/BillboardComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/StaticMeshSocket.h"
+#include "StaticMeshResources.h"
+
+#include <atomic>
+
+#if WITH_EDITOR
+#include "UObject/UObjectGlobals.h"
+#endif
 
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(PCGCGetActorDataExtended)
@@ -40,6 +57,244 @@ namespace PCGDataFromActorConstants
 
 namespace PCGDataFromActorHelpers
 {
+	/** Instanced components are converted to points in batches of this many instances. */
+	static constexpr int32 InstanceBatchSize = 4096;
+
+	/** Combined into the actor cache key, so the outputs of an actor don't share an entry. */
+	static constexpr uint64 SinglePointCacheEntry = 1;
+	static constexpr uint64 PropertiesCacheEntry = 2;
+	static constexpr uint64 ComponentsCacheEntry = 3;
+
+	static TAutoConsoleVariable<int32> CVarActorCacheBudgetMB(
+		TEXT("pcgc.GetActorData.ActorCacheBudgetMB"),
+		256,
+		TEXT("Memory budget in MB of the per-actor output cache shared by Get Actor Data Extended nodes."));
+
+	/** Outputs of each unchanged actor, shared by every Get Actor Data Extended node. */
+	static FPCGCDataCache& GetActorCache()
+	{
+		static FPCGCDataCache ActorCache(TEXT("PCGCGetActorDataActorCache"));
+		return ActorCache;
+	}
+
+	/** Actor outputs reused from the cache and rebuilt, by every node since startup. */
+	static std::atomic<int64> NumReusedOutputs = 0;
+	static std::atomic<int64> NumRebuiltOutputs = 0;
+
+	static FAutoConsoleCommand CommandActorCacheStats(
+		TEXT("pcgc.GetActorData.ActorCacheStats"),
+		TEXT("Logs the hit and miss counters of the Get Actor Data Extended actor cache."),
+		FConsoleCommandDelegate::CreateLambda([]()
+		{
+			const FPCGCDataCacheStats Stats = GetActorCache().GetStats();
+			const double HitRate = (Stats.Hits + Stats.Misses) > 0 ? 100.0 * Stats.Hits / (Stats.Hits + Stats.Misses) : 0.0;
+			UE_LOG(LogPCG, Log, TEXT("Get Actor Data Extended actor cache: %lld hits, %lld misses (%.1f%% hit rate), %lld evictions, %d entries, %.2f MB"), Stats.Hits, Stats.Misses, HitRate, Stats.Evictions, Stats.NumEntries, Stats.MemorySize / (1024.0 * 1024.0));
+			UE_LOG(LogPCG, Log, TEXT("Get Actor Data Extended actor outputs: %lld reused, %lld rebuilt"), NumReusedOutputs.load(std::memory_order_relaxed), NumRebuiltOutputs.load(std::memory_order_relaxed));
+		}));
+
+	static FAutoConsoleCommand CommandClearActorCache(
+		TEXT("pcgc.GetActorData.ClearActorCache"),
+		TEXT("Empties the Get Actor Data Extended actor cache."),
+		FConsoleCommandDelegate::CreateLambda([]()
+		{
+			GetActorCache().Reset();
+		}));
+
+	/** Components are hashed separately, the packed transform may hold padding. */
+	static uint32 CrcTransform(const FTransform& Transform, uint32 Crc)
+	{
+		const FQuat Rotation = Transform.GetRotation();
+		const FVector Translation = Transform.GetTranslation();
+		const FVector Scale = Transform.GetScale3D();
+
+		Crc = FCrc::MemCrc32(&Rotation, sizeof(FQuat), Crc);
+		Crc = FCrc::MemCrc32(&Translation, sizeof(FVector), Crc);
+		return FCrc::MemCrc32(&Scale, sizeof(FVector), Crc);
+	}
+
+	/** Tags are hashed on their display index, so that renaming the case of a tag changes the CRC. */
+	static uint32 CrcTags(const TArray<FName>& Tags, uint32 Crc)
+	{
+		const int32 NumTags = Tags.Num();
+		Crc = FCrc::MemCrc32(&NumTags, sizeof(int32), Crc);
+
+		for (const FName& Tag : Tags)
+		{
+			const uint32 TagHash = HashCombineFast(GetTypeHash(Tag.GetDisplayIndex()), uint32(Tag.GetNumber()));
+			Crc = FCrc::MemCrc32(&TagHash, sizeof(uint32), Crc);
+		}
+
+		return Crc;
+	}
+
+	/**
+	 * Key of the outputs of an actor, from the settings, the actor object key and a cheap CRC of the actor state:
+	 * its transform and tags, and the transform, bounds, mesh and tags of each primitive component. Instance buffers are hashed when extracting instances.
+	 * Selected properties are hashed separately, see CrcActorProperties.
+	 */
+	static uint64 ComputeActorCacheKey(const UPCGCGetActorDataExtendedSettings* Settings, const AActor* Actor)
+	{
+		uint32 Crc = CrcTransform(Actor->GetActorTransform(), 0);
+		Crc = CrcTags(Actor->Tags, Crc);
+
+		TInlineComponentArray<UPrimitiveComponent*, 4> Primitives;
+		Actor->GetComponents(Primitives);
+
+		const int32 NumPrimitives = Primitives.Num();
+		Crc = FCrc::MemCrc32(&NumPrimitives, sizeof(int32), Crc);
+
+		for (const UPrimitiveComponent* Primitive : Primitives)
+		{
+			Crc = CrcTransform(Primitive->GetComponentTransform(), Crc);
+			Crc = FCrc::MemCrc32(&Primitive->Bounds.Origin, sizeof(FVector), Crc);
+			Crc = FCrc::MemCrc32(&Primitive->Bounds.BoxExtent, sizeof(FVector), Crc);
+			Crc = CrcTags(Primitive->ComponentTags, Crc);
+
+			if (const UStaticMeshComponent* StaticMeshComponent = Cast<UStaticMeshComponent>(Primitive))
+			{
+				const UStaticMesh* StaticMesh = StaticMeshComponent->GetStaticMesh();
+				const uint32 MeshId = StaticMesh ? StaticMesh->GetUniqueID() : 0;
+				Crc = FCrc::MemCrc32(&MeshId, sizeof(uint32), Crc);
+			}
+
+			const UInstancedStaticMeshComponent* InstancedComponent = Settings->bExtractInstances ? Cast<UInstancedStaticMeshComponent>(Primitive) : nullptr;
+			if (InstancedComponent)
+			{
+				Crc = FCrc::MemCrc32(InstancedComponent->PerInstanceSMData.GetData(), InstancedComponent->PerInstanceSMData.Num() * sizeof(FInstancedStaticMeshInstanceData), Crc);
+				Crc = FCrc::MemCrc32(InstancedComponent->PerInstanceSMCustomData.GetData(), InstancedComponent->PerInstanceSMCustomData.Num() * sizeof(float), Crc);
+				Crc = FCrc::MemCrc32(&InstancedComponent->NumCustomDataFloats, sizeof(int32), Crc);
+			}
+		}
+
+		uint64 Key = FPCGCDataCache::CombineKey(Settings->GetSettingsCrc().GetValue(), GetTypeHash(FObjectKey(Actor)));
+		return FPCGCDataCache::CombineKey(Key, Crc);
+	}
+
+	/** Container holding the value of a resolved property on the actor, nullptr for an unset object reference. */
+	static const void* GetPropertyContainer(const FPCGCResolvedActorProperty& ResolvedProperty, const AActor* Actor)
+	{
+		if (const FStructProperty* StructProperty = CastField<FStructProperty>(ResolvedProperty.OuterProperty))
+		{
+			return StructProperty->ContainerPtrToValuePtr<void>(Actor);
+		}
+		else if (const FObjectProperty* ObjectProperty = CastField<FObjectProperty>(ResolvedProperty.OuterProperty))
+		{
+			return ObjectProperty->GetObjectPropertyValue_InContainer(Actor);
+		}
+
+		return Actor;
+	}
+
+	/** CRC of the selected property values. Plain old data is hashed as is, other values through their text export since they hold pointers. */
+	static uint32 CrcActorProperties(const FPCGCResolvedActorProperties& ResolvedProperties, const AActor* Actor)
+	{
+		uint32 Crc = 0;
+		FString ExportedValue;
+
+		for (const FPCGCResolvedActorProperty& ResolvedProperty : ResolvedProperties.Properties)
+		{
+			const void* ContainerPtr = GetPropertyContainer(ResolvedProperty, Actor);
+			const uint8 bIsSet = ContainerPtr != nullptr;
+			Crc = FCrc::MemCrc32(&bIsSet, sizeof(uint8), Crc);
+
+			if (!ContainerPtr)
+			{
+				continue;
+			}
+
+			const void* ValuePtr = ResolvedProperty.Property->ContainerPtrToValuePtr<void>(ContainerPtr);
+
+			if (ResolvedProperty.Property->HasAnyPropertyFlags(CPF_IsPlainOldData))
+			{
+				Crc = FCrc::MemCrc32(ValuePtr, ResolvedProperty.Property->GetSize(), Crc);
+			}
+			else
+			{
+				ExportedValue.Reset();
+				ResolvedProperty.Property->ExportTextItem_Direct(ExportedValue, ValuePtr, nullptr, nullptr, PPF_None);
+				Crc = FCrc::StrCrc32(*ExportedValue, Crc);
+			}
+		}
+
+		return Crc;
+	}
+
+	/**
+	 * Holds the cached data in the context output data, so it can't be collected before the outputs are assembled. Returns its index, INDEX_NONE on a miss.
+	 * Data cached for another actor is a miss, the key alone can collide.
+	 */
+	static int32 HoldCachedOutput(FPCGContext* Context, uint64 Key, const AActor* Actor)
+	{
+		const UPCGData* CachedData = GetActorCache().Find(Key, Actor);
+		if (!CachedData)
+		{
+			return INDEX_NONE;
+		}
+
+		FPCGTaggedData& Output = Context->OutputData.TaggedData.Emplace_GetRef();
+		Output.Data = CachedData;
+		return Context->OutputData.TaggedData.Num() - 1;
+	}
+
+	static int32 GetNumSplineSegments(const FPCGCSplineSnapshot& Spline)
+	{
+		const int32 NumControlPoints = Spline.Curves.Position.Points.Num();
+		return Spline.Curves.Position.bIsLooped ? NumControlPoints : FMath::Max(NumControlPoints - 1, 0);
+	}
+
+	/** Open splines also get a sample on their last control point, closed ones end where they start. */
+	static int32 GetNumSplineSamples(const UPCGCGetActorDataExtendedSettings* Settings, const FPCGCSplineSnapshot& Spline)
+	{
+		if (Spline.Curves.Position.Points.IsEmpty())
+		{
+			return 0;
+		}
+
+		const bool bIsClosed = Spline.Curves.Position.bIsLooped;
+
+		if (Settings->SplineSamplingMode == EPCGCSplineSamplingMode::Distance)
+		{
+			const double Length = Spline.Curves.GetSplineLength();
+			const int32 NumSteps = FMath::CeilToInt32(Length / FMath::Max(Settings->SplineSamplingDistance, 1.0));
+			return FMath::Max(bIsClosed ? NumSteps : NumSteps + 1, 1);
+		}
+		else
+		{
+			const int32 NumSamplesPerSegment = FMath::Max(Settings->SplineSubdivisionsPerSegment, 0) + 1;
+			return FMath::Max(GetNumSplineSegments(Spline) * NumSamplesPerSegment + (bIsClosed ? 0 : 1), 1);
+		}
+	}
+
+	/** World transform of a sample, same as the spline component transform at the sample input key. */
+	static FTransform GetSplineSampleTransform(const UPCGCGetActorDataExtendedSettings* Settings, const FPCGCSplineSnapshot& Spline, int32 SampleIndex, int32 NumSamples)
+	{
+		const FSplineCurves& Curves = Spline.Curves;
+
+		float InputKey = 0.0f;
+		if (Settings->SplineSamplingMode == EPCGCSplineSamplingMode::Distance)
+		{
+			const double Length = Curves.GetSplineLength();
+			const double Distance = FMath::Min(SampleIndex * FMath::Max(Settings->SplineSamplingDistance, 1.0), Length);
+			InputKey = Curves.ReparamTable.Eval(static_cast<float>(Distance), 0.0f);
+		}
+		else
+		{
+			const int32 NumSamplesPerSegment = FMath::Max(Settings->SplineSubdivisionsPerSegment, 0) + 1;
+			InputKey = static_cast<float>(SampleIndex) / NumSamplesPerSegment;
+		}
+
+		const FVector Location = Curves.Position.Eval(InputKey, FVector::ZeroVector);
+
+		FQuat Rotation = Curves.Rotation.Eval(InputKey, FQuat::Identity);
+		Rotation.Normalize();
+		const FVector Direction = Curves.Position.EvalDerivative(InputKey, FVector::ZeroVector).GetSafeNormal();
+		const FVector UpVector = Rotation.RotateVector(Spline.DefaultUpVector);
+
+		const FVector Scale = Curves.Scale.Eval(InputKey, FVector::OneVector);
+
+		return FTransform(FRotationMatrix::MakeFromXZ(Direction, UpVector).ToQuat(), Location, Scale) * Spline.Transform;
+	}
+
 	/**
 	 * Get the PCG Components associated with an actor. Optionally, also search for any local components associated with components
 	 * on the actor using the 'bGetLocalComponents' flag. By default, gets data on all grids, but alternatively you can provide a
@@ -134,6 +389,329 @@ namespace PCGDataFromActorHelpers
 
 		return PCGComponents;
 	}
+
+	/** Tag attributes of the component points, each one holding the tag found at the same index as its name. Values are written in bulk once all points are filled. */
+	struct FTagAttributeWriter
+	{
+		struct FTagAttribute
+		{
+			FPCGMetadataAttribute<FName>* Attribute = nullptr;
+			int32 TagIndex = INDEX_NONE;
+			bool bIsActorTag = false;
+			TArray<FName> Values;
+		};
+
+		TArray<FTagAttribute> TagAttributes;
+
+		FTagAttributeWriter(UPCGPointData* PointData, const UPCGCGetActorDataExtendedSettings* Settings, bool bWriteActorTags)
+		{
+			AddTagAttributes(PointData, Settings->ComponentTagAttributeNames, /*bIsActorTag=*/false);
+			if (bWriteActorTags)
+			{
+				AddTagAttributes(PointData, Settings->ActorTagAttributeNames, /*bIsActorTag=*/true);
+			}
+
+			// Attributes with the same name as another one of another type are not written
+			TagAttributes.RemoveAll([](const FTagAttribute& TagAttribute) { return TagAttribute.Attribute == nullptr; });
+		}
+
+		bool IsEmpty() const { return TagAttributes.IsEmpty(); }
+
+		void Allocate(int32 NumPoints)
+		{
+			for (FTagAttribute& TagAttribute : TagAttributes)
+			{
+				TagAttribute.Values.SetNumUninitialized(NumPoints);
+			}
+		}
+
+		/** Thread safe as long as each point is set by a single thread. */
+		void SetValues(int32 PointIndex, const TArray<FName>& ActorTags, const TArray<FName>& ComponentTags)
+		{
+			for (FTagAttribute& TagAttribute : TagAttributes)
+			{
+				const TArray<FName>& Tags = TagAttribute.bIsActorTag ? ActorTags : ComponentTags;
+				TagAttribute.Values[PointIndex] = Tags.IsValidIndex(TagAttribute.TagIndex) ? Tags[TagAttribute.TagIndex] : NAME_None;
+			}
+		}
+
+		void Write(const TArray<PCGMetadataEntryKey>& EntryKeys)
+		{
+			for (FTagAttribute& TagAttribute : TagAttributes)
+			{
+				TagAttribute.Attribute->SetValues(EntryKeys, TagAttribute.Values);
+			}
+		}
+
+	private:
+		void AddTagAttributes(UPCGPointData* PointData, const TArray<FName>& AttributeNames, bool bIsActorTag)
+		{
+			for (int32 TagIndex = 0; TagIndex < AttributeNames.Num(); TagIndex++)
+			{
+				if (AttributeNames[TagIndex] == NAME_None) {
+					continue;
+				}
+
+				FTagAttribute& TagAttribute = TagAttributes.Emplace_GetRef();
+				TagAttribute.Attribute = PointData->Metadata->FindOrCreateAttribute<FName>(AttributeNames[TagIndex], NAME_None, /*bAllowInterpolation=*/false, /*bOverrideParent=*/false, /*bOverwriteIfTypeMismatch=*/ false);
+				TagAttribute.TagIndex = TagIndex;
+				TagAttribute.bIsActorTag = bIsActorTag;
+			}
+		}
+	};
+
+	/** One metadata entry per point, created up front so that the points can be filled in parallel. */
+	static TArray<PCGMetadataEntryKey> AddEntries(UPCGMetadata* Metadata, int32 NumPoints)
+	{
+		TArray<PCGMetadataEntryKey> EntryKeys;
+		EntryKeys.SetNumUninitialized(NumPoints);
+		for (int32 PointIndex = 0; PointIndex < NumPoints; ++PointIndex)
+		{
+			EntryKeys[PointIndex] = Metadata->AddEntry();
+		}
+
+		return EntryKeys;
+	}
+
+	/**
+	 * Mesh space sockets and vertices of a static mesh. Vertices are read from the render data of the LOD, which cooked builds only keep on the CPU
+	 * when the mesh allows CPU access. OutbVerticesUnavailable is set when they can't be read.
+	 */
+	static TSharedPtr<const FPCGCMeshLocalData> ExtractMeshLocalData(const UStaticMesh* StaticMesh, bool bExtractSockets, bool bExtractVertices, int32 LODIndex, bool& OutbVerticesUnavailable)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(PCGDataFromActorHelpers::ExtractMeshLocalData);
+
+		check(StaticMesh);
+
+		TSharedPtr<FPCGCMeshLocalData> LocalData = MakeShared<FPCGCMeshLocalData>();
+
+		if (bExtractSockets)
+		{
+			LocalData->SocketNames.Reserve(StaticMesh->Sockets.Num());
+			LocalData->SocketTransforms.Reserve(StaticMesh->Sockets.Num());
+
+			for (const UStaticMeshSocket* Socket : StaticMesh->Sockets)
+			{
+				if (Socket)
+				{
+					LocalData->SocketNames.Add(Socket->SocketName);
+					LocalData->SocketTransforms.Emplace(Socket->RelativeRotation, Socket->RelativeLocation, Socket->RelativeScale);
+				}
+			}
+		}
+
+		if (bExtractVertices)
+		{
+			const FStaticMeshRenderData* RenderData = StaticMesh->GetRenderData();
+			const bool bCanReadVertices = RenderData && !RenderData->LODResources.IsEmpty() && (WITH_EDITOR || StaticMesh->bAllowCPUAccess);
+
+			if (bCanReadVertices)
+			{
+				const FStaticMeshLODResources& LODResources = RenderData->LODResources[FMath::Clamp(LODIndex, FMath::Max(int32(RenderData->CurrentFirstLODIdx), 0), RenderData->LODResources.Num() - 1)];
+				const FPositionVertexBuffer& PositionBuffer = LODResources.VertexBuffers.PositionVertexBuffer;
+				const FStaticMeshVertexBuffer& VertexBuffer = LODResources.VertexBuffers.StaticMeshVertexBuffer;
+				const int32 NumVertices = PositionBuffer.GetNumVertices();
+
+				LocalData->VertexPositions.SetNumUninitialized(NumVertices);
+				LocalData->VertexNormals.SetNumUninitialized(NumVertices);
+
+				for (int32 VertexIndex = 0; VertexIndex < NumVertices; ++VertexIndex)
+				{
+					LocalData->VertexPositions[VertexIndex] = PositionBuffer.VertexPosition(VertexIndex);
+					LocalData->VertexNormals[VertexIndex] = FVector3f(VertexBuffer.VertexTangentZ(VertexIndex));
+				}
+			}
+			else
+			{
+				OutbVerticesUnavailable = true;
+			}
+		}
+
+		return LocalData;
+	}
+
+	/** LOD the vertices are read from: the requested one, clamped to the LODs currently resident, since streamed out LODs have empty buffers. */
+	static int32 GetResidentVertexLOD(const UStaticMesh* StaticMesh, int32 RequestedLOD)
+	{
+		const FStaticMeshRenderData* RenderData = StaticMesh->GetRenderData();
+		if (!RenderData || RenderData->LODResources.IsEmpty())
+		{
+			return 0;
+		}
+
+		const int32 LastLOD = RenderData->LODResources.Num() - 1;
+		return FMath::Clamp(RequestedLOD, FMath::Clamp(int32(RenderData->CurrentFirstLODIdx), 0, LastLOD), LastLOD);
+	}
+
+	static TAutoConsoleVariable<int32> CVarMeshCacheBudgetMB(
+		TEXT("pcgc.GetActorData.MeshCacheBudgetMB"),
+		64,
+		TEXT("Memory budget in MB of the mesh space sockets and vertices cache shared by Get Actor Data Extended nodes."));
+
+	/**
+	 * Mesh space sockets and vertices per mesh, LOD and extracted parts, kept across executions and evicting the least recently used meshes when over budget.
+	 * Entries are dropped when the render data of the mesh is rebuilt, and in editor when the mesh is edited. Only accessed from the game thread.
+	 */
+	class FMeshLocalDataCache
+	{
+	public:
+		FMeshLocalDataCache()
+		{
+#if WITH_EDITOR
+			ObjectPropertyChangedHandle = FCoreUObjectDelegates::OnObjectPropertyChanged.AddRaw(this, &FMeshLocalDataCache::OnObjectPropertyChanged);
+#endif
+		}
+
+		~FMeshLocalDataCache()
+		{
+#if WITH_EDITOR
+			// Destroyed on module unload, before the delegates of CoreUObject
+			FCoreUObjectDelegates::OnObjectPropertyChanged.Remove(ObjectPropertyChangedHandle);
+#endif
+		}
+
+		/** Returns the cached data of the mesh, or extracts and caches it. OutbVerticesUnavailable is set when its vertices could not be read. */
+		TSharedPtr<const FPCGCMeshLocalData> FindOrExtract(const UStaticMesh* StaticMesh, bool bExtractSockets, bool bExtractVertices, int32 LODIndex, bool& OutbVerticesUnavailable)
+		{
+			const FKey Key{ TObjectKey<UStaticMesh>(StaticMesh), bExtractVertices ? LODIndex : INDEX_NONE, bExtractSockets, bExtractVertices };
+			const FStaticMeshRenderData* RenderData = StaticMesh->GetRenderData();
+
+			if (FEntry* Entry = Entries.Find(Key))
+			{
+				if (Entry->RenderData == RenderData)
+				{
+					Entry->LastAccess = ++AccessCounter;
+					OutbVerticesUnavailable = Entry->bVerticesUnavailable;
+					return Entry->LocalData;
+				}
+
+				MemorySize -= Entry->MemorySize;
+				Entries.Remove(Key);
+			}
+
+			bool bVerticesUnavailable = false;
+			TSharedPtr<const FPCGCMeshLocalData> LocalData = ExtractMeshLocalData(StaticMesh, bExtractSockets, bExtractVertices, LODIndex, bVerticesUnavailable);
+			OutbVerticesUnavailable = bVerticesUnavailable;
+
+			FEntry& Entry = Entries.Add(Key);
+			Entry.LocalData = LocalData;
+			Entry.RenderData = RenderData;
+			Entry.MemorySize = sizeof(FPCGCMeshLocalData) + LocalData->SocketNames.GetAllocatedSize() + LocalData->SocketTransforms.GetAllocatedSize()
+				+ LocalData->VertexPositions.GetAllocatedSize() + LocalData->VertexNormals.GetAllocatedSize();
+			Entry.LastAccess = ++AccessCounter;
+			Entry.bVerticesUnavailable = bVerticesUnavailable;
+			MemorySize += Entry.MemorySize;
+
+			EvictToBudget(int64(FMath::Max(CVarMeshCacheBudgetMB.GetValueOnGameThread(), 0)) * 1024 * 1024);
+
+			return LocalData;
+		}
+
+		void RemoveMesh(const UStaticMesh* StaticMesh)
+		{
+			const TObjectKey<UStaticMesh> MeshKey(StaticMesh);
+			for (auto It = Entries.CreateIterator(); It; ++It)
+			{
+				if (It->Key.Mesh == MeshKey)
+				{
+					MemorySize -= It->Value.MemorySize;
+					It.RemoveCurrent();
+				}
+			}
+		}
+
+		void Reset()
+		{
+			Entries.Empty();
+			MemorySize = 0;
+		}
+
+		int32 GetNum() const { return Entries.Num(); }
+		int64 GetMemorySize() const { return MemorySize; }
+
+	private:
+		struct FKey
+		{
+			TObjectKey<UStaticMesh> Mesh;
+			int32 LODIndex = INDEX_NONE;
+			bool bSockets = false;
+			bool bVertices = false;
+
+			bool operator==(const FKey& Other) const { return Mesh == Other.Mesh && LODIndex == Other.LODIndex && bSockets == Other.bSockets && bVertices == Other.bVertices; }
+			friend uint32 GetTypeHash(const FKey& Key) { return HashCombine(GetTypeHash(Key.Mesh), GetTypeHash(Key.LODIndex) ^ (uint32(Key.bSockets) << 30) ^ (uint32(Key.bVertices) << 31)); }
+		};
+
+		struct FEntry
+		{
+			TSharedPtr<const FPCGCMeshLocalData> LocalData;
+
+			/** Rebuilding the mesh replaces its render data, the entry is then stale. Only compared, never dereferenced. */
+			const FStaticMeshRenderData* RenderData = nullptr;
+			int64 MemorySize = 0;
+			uint64 LastAccess = 0;
+			bool bVerticesUnavailable = false;
+		};
+
+#if WITH_EDITOR
+		void OnObjectPropertyChanged(UObject* Object, FPropertyChangedEvent& PropertyChangedEvent)
+		{
+			if (const UStaticMesh* StaticMesh = Cast<UStaticMesh>(Object))
+			{
+				RemoveMesh(StaticMesh);
+			}
+		}
+#endif
+
+		void EvictToBudget(int64 MemoryBudget)
+		{
+			// Meshes are few compared to components, a linear scan for the oldest entry is enough
+			while (MemorySize > MemoryBudget && !Entries.IsEmpty())
+			{
+				auto Oldest = Entries.CreateIterator();
+				for (auto It = Entries.CreateIterator(); It; ++It)
+				{
+					if (It->Value.LastAccess < Oldest->Value.LastAccess)
+					{
+						Oldest = It;
+					}
+				}
+
+				MemorySize -= Oldest->Value.MemorySize;
+				Oldest.RemoveCurrent();
+			}
+		}
+
+		TMap<FKey, FEntry> Entries;
+		int64 MemorySize = 0;
+		uint64 AccessCounter = 0;
+
+#if WITH_EDITOR
+		FDelegateHandle ObjectPropertyChangedHandle;
+#endif
+	};
+
+	static FMeshLocalDataCache& GetMeshLocalDataCache()
+	{
+		static FMeshLocalDataCache MeshLocalDataCache;
+		return MeshLocalDataCache;
+	}
+
+	static FAutoConsoleCommand CommandMeshCacheStats(
+		TEXT("pcgc.GetActorData.MeshCacheStats"),
+		TEXT("Logs the size of the Get Actor Data Extended mesh sockets and vertices cache."),
+		FConsoleCommandDelegate::CreateLambda([]()
+		{
+			const FMeshLocalDataCache& MeshLocalDataCache = GetMeshLocalDataCache();
+			UE_LOG(LogPCG, Log, TEXT("Get Actor Data Extended mesh cache: %d entries, %.2f MB"), MeshLocalDataCache.GetNum(), MeshLocalDataCache.GetMemorySize() / (1024.0 * 1024.0));
+		}));
+
+	static FAutoConsoleCommand CommandClearMeshCache(
+		TEXT("pcgc.GetActorData.ClearMeshCache"),
+		TEXT("Empties the Get Actor Data Extended mesh sockets and vertices cache."),
+		FConsoleCommandDelegate::CreateLambda([]()
+		{
+			GetMeshLocalDataCache().Reset();
+		}));
 }
 
 
@@ -261,11 +839,23 @@ TArray<FPCGPinProperties> UPCGCGetActorDataExtendedSettings::OutputPinProperties
 		Pins.Emplace(ComponentsPinName, EPCGDataType::Point);
 	}
 
-	return Pins;
-}
+	if (bGetActorComponentsAsPoints && bSampleSplines) {
+		Pins.Emplace(SplinesPinName, EPCGDataType::Point);
+	}
 
-FPCGContext* FPCGCGetActorDataExtendedElement::CreateContext()
-{
+	if (bGetActorComponentsAsPoints && bExtractMeshSockets) {
+		Pins.Emplace(SocketsPinName, EPCGDataType::Point);
+	}
+
+	if (bGetActorComponentsAsPoints && bExtractMeshVertices) {
+		Pins.Emplace(VerticesPinName, EPCGDataType::Point);
+	}
+
+	return Pins;
+}
+
+FPCGContext* FPCGCGetActorDataExtendedElement::CreateContext()
+{
 	return new FPCGDataFromActorContext();
 }
 
@@ -279,9 +869,9 @@ FPCGContext* FPCGCGetActorDataExtendedElement::CreateContext()
 //	return Context;
 //}
 
-bool FPCGCGetActorDataExtendedElement::ExecuteInternal(FPCGContext* InContext) const
+bool FPCGCGetActorDataExtendedElement::PrepareDataInternal(FPCGContext* InContext) const
 {
-	TRACE_CPUPROFILER_EVENT_SCOPE(FPCGCGetActorDataExtendedElement::Execute);
+	TRACE_CPUPROFILER_EVENT_SCOPE(FPCGCGetActorDataExtendedElement::PrepareData);
 
 	check(InContext);
 	FPCGDataFromActorContext* Context = static_cast<FPCGDataFromActorContext*>(InContext);
@@ -382,6 +972,19 @@ bool FPCGCGetActorDataExtendedElement::ExecuteInternal(FPCGContext* InContext) c
 			}
 		}
 
+		// Tag and class queries over all world actors are answered by the actor index, only visiting the matching actors
+		if (!Context->bPerformedQuery && Settings->bUseActorIndex)
+		{
+			if (UPCGCActorIndexSubsystem* ActorIndex = UPCGCActorIndexSubsystem::Get(PCGComponent ? PCGComponent->GetWorld() : nullptr))
+			{
+				TRACE_CPUPROFILER_EVENT_SCOPE(FPCGCGetActorDataExtendedElement::Execute::FindActorsFromIndex);
+
+				const FBox OverlapBounds = (Self && Settings->ActorSelector.bMustOverlapSelf) ? PCGHelpers::GetActorBounds(Self) : FBox(EForceInit::ForceInit);
+				auto Filter = [&BoundsCheck, &SelfIgnoreCheck](const AActor* Actor) { return BoundsCheck(Actor) && SelfIgnoreCheck(Actor); };
+				Context->bPerformedQuery = ActorIndex->FindActors(Settings->ActorSelector, OverlapBounds, Filter, Context->FoundActors);
+			}
+		}
+
 		if (!Context->bPerformedQuery)
 		{
 			TRACE_CPUPROFILER_EVENT_SCOPE(FPCGCGetActorDataExtendedElement::Execute::FindActors);
@@ -461,6 +1064,178 @@ bool FPCGCGetActorDataExtendedElement::ExecuteInternal(FPCGContext* InContext) c
 	return true;
 }
 
+bool FPCGCGetActorDataExtendedElement::ExecuteInternal(FPCGContext* InContext) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FPCGCGetActorDataExtendedElement::Execute);
+
+	check(InContext);
+	FPCGDataFromActorContext* Context = static_cast<FPCGDataFromActorContext*>(InContext);
+
+	const UPCGCGetActorDataExtendedSettings* Settings = Context->GetInputSettings<UPCGCGetActorDataExtendedSettings>();
+	check(Settings);
+
+	const TArray<FPCGCActorSnapshot>& Snapshots = Context->ActorSnapshots;
+	if (Snapshots.IsEmpty())
+	{
+		return true;
+	}
+
+	TArray<FPCGTaggedData>& Outputs = Context->OutputData.TaggedData;
+
+	// Every actor builds its own data from its snapshot, outputs are then added in the found actors order
+	TArray<const UPCGData*> PropertiesData;
+	TArray<const UPCGData*> ComponentsData;
+	TArray<TArray<FName>> FailedProperties;
+	PropertiesData.SetNumZeroed(Snapshots.Num());
+	ComponentsData.SetNumZeroed(Snapshots.Num());
+	FailedProperties.SetNum(Snapshots.Num());
+
+	// Outputs of the unchanged actors were found in the actor cache during the PrepareData phase
+	TArray<int32> HeldOutputIndices;
+	for (int32 ActorIndex = 0; ActorIndex < Snapshots.Num(); ++ActorIndex)
+	{
+		const FPCGCActorSnapshot& Snapshot = Snapshots[ActorIndex];
+
+		if (Snapshot.CachedPropertiesIndex != INDEX_NONE)
+		{
+			PropertiesData[ActorIndex] = Outputs[Snapshot.CachedPropertiesIndex].Data;
+			HeldOutputIndices.Add(Snapshot.CachedPropertiesIndex);
+		}
+
+		if (Snapshot.CachedComponentsIndex != INDEX_NONE)
+		{
+			ComponentsData[ActorIndex] = Outputs[Snapshot.CachedComponentsIndex].Data;
+			HeldOutputIndices.Add(Snapshot.CachedComponentsIndex);
+		}
+	}
+
+	const bool bMergeActorProperties = Settings->bGetActorProperties && Settings->bMergeActorProperties;
+	const bool bMergeComponentsPoints = Settings->bGetActorComponentsAsPoints && Settings->bMergeComponentsPoints;
+
+	ParallelFor(Snapshots.Num(), [this, Settings, bMergeActorProperties, bMergeComponentsPoints, &Snapshots, &PropertiesData, &ComponentsData, &FailedProperties](int32 ActorIndex)
+	{
+		if (Settings->bGetActorProperties && !bMergeActorProperties && !PropertiesData[ActorIndex])
+		{
+			PropertiesData[ActorIndex] = GetActorProperties(Snapshots[ActorIndex], FailedProperties[ActorIndex]);
+		}
+
+		if (Settings->bGetActorComponentsAsPoints && !bMergeComponentsPoints && !ComponentsData[ActorIndex])
+		{
+			ComponentsData[ActorIndex] = GetComponentsAsPoints(Settings, MakeArrayView(&Snapshots[ActorIndex], 1), /*bWriteActorTags=*/false);
+		}
+	});
+
+	if (Settings->bCacheActorData)
+	{
+		const int32 NumReusedOutputs = HeldOutputIndices.Num();
+		int32 NumRebuiltOutputs = 0;
+
+		for (int32 ActorIndex = 0; ActorIndex < Snapshots.Num(); ++ActorIndex)
+		{
+			const FPCGCActorSnapshot& Snapshot = Snapshots[ActorIndex];
+
+			// Properties that failed to extract are not cached, so that the error is logged on every execution
+			if (Snapshot.PropertiesCacheKey != 0 && Snapshot.CachedPropertiesIndex == INDEX_NONE && PropertiesData[ActorIndex] && FailedProperties[ActorIndex].IsEmpty())
+			{
+				PCGDataFromActorHelpers::GetActorCache().Add(Snapshot.PropertiesCacheKey, PropertiesData[ActorIndex], Snapshot.Actor.ResolveObjectPtr());
+				++NumRebuiltOutputs;
+			}
+
+			if (Snapshot.ComponentsCacheKey != 0 && Snapshot.CachedComponentsIndex == INDEX_NONE && ComponentsData[ActorIndex])
+			{
+				PCGDataFromActorHelpers::GetActorCache().Add(Snapshot.ComponentsCacheKey, ComponentsData[ActorIndex], Snapshot.Actor.ResolveObjectPtr());
+				++NumRebuiltOutputs;
+			}
+		}
+
+		PCGDataFromActorHelpers::NumReusedOutputs.fetch_add(NumReusedOutputs, std::memory_order_relaxed);
+		PCGDataFromActorHelpers::NumRebuiltOutputs.fetch_add(NumRebuiltOutputs, std::memory_order_relaxed);
+		PCGE_LOG(Verbose, LogOnly, FText::Format(LOCTEXT("ActorCacheInfo", "Actor cache: {0} actor outputs reused, {1} rebuilt"), NumReusedOutputs, NumRebuiltOutputs));
+	}
+
+	// Single attribute set with a row per actor, written a column at a time
+	if (bMergeActorProperties)
+	{
+		PropertiesData[0] = GetMergedActorProperties(Snapshots, FailedProperties[0]);
+	}
+
+	// Single point data for the components of all actors, actor tags are written to attributes
+	if (bMergeComponentsPoints)
+	{
+		ComponentsData[0] = GetComponentsAsPoints(Settings, Snapshots, /*bWriteActorTags=*/true);
+	}
+
+	// Splines of all actors are sampled into a single point data
+	UPCGPointData* SplinesData = (Settings->bGetActorComponentsAsPoints && Settings->bSampleSplines) ? GetSplinesAsPoints(Settings, Snapshots) : nullptr;
+
+	// Sockets and vertices of all actors, each from the mesh space data of its mesh
+	UPCGPointData* SocketsData = (Settings->bGetActorComponentsAsPoints && Settings->bExtractMeshSockets) ? GetMeshesAsPoints(Settings, Snapshots, /*bVertices=*/false) : nullptr;
+	UPCGPointData* VerticesData = (Settings->bGetActorComponentsAsPoints && Settings->bExtractMeshVertices) ? GetMeshesAsPoints(Settings, Snapshots, /*bVertices=*/true) : nullptr;
+
+	for (int32 ActorIndex = 0; ActorIndex < Snapshots.Num(); ++ActorIndex)
+	{
+		for (const FName& PropertyName : FailedProperties[ActorIndex])
+		{
+			PCGE_LOG(Error, GraphAndLog, FText::Format(LOCTEXT("ErrorCreatingAttribute", "Error while creating an attribute for property '{0}'. Either the property type is not supported by PCG or attribute creation failed."), FText::FromName(PropertyName)));
+		}
+
+		if (PropertiesData[ActorIndex])
+		{
+			FPCGTaggedData& Output = Outputs.Emplace_GetRef();
+			Output.Pin = Settings->PropertiesPinName;
+			Output.Data = PropertiesData[ActorIndex];
+		}
+	}
+
+	for (int32 ActorIndex = 0; ActorIndex < Snapshots.Num(); ++ActorIndex)
+	{
+		if (ComponentsData[ActorIndex])
+		{
+			FPCGTaggedData& Output = Outputs.Emplace_GetRef();
+			Output.Pin = Settings->ComponentsPinName;
+			Output.Data = ComponentsData[ActorIndex];
+
+			if (!bMergeComponentsPoints)
+			{
+				Algo::Transform(Snapshots[ActorIndex].Tags, Output.Tags, [](const FName& InName) { return InName.ToString(); });
+			}
+		}
+	}
+
+	if (SplinesData)
+	{
+		FPCGTaggedData& Output = Outputs.Emplace_GetRef();
+		Output.Pin = Settings->SplinesPinName;
+		Output.Data = SplinesData;
+	}
+
+	if (SocketsData)
+	{
+		FPCGTaggedData& Output = Outputs.Emplace_GetRef();
+		Output.Pin = Settings->SocketsPinName;
+		Output.Data = SocketsData;
+	}
+
+	if (VerticesData)
+	{
+		FPCGTaggedData& Output = Outputs.Emplace_GetRef();
+		Output.Pin = Settings->VerticesPinName;
+		Output.Data = VerticesData;
+	}
+
+	// The held cached outputs are now referenced by the outputs above
+	HeldOutputIndices.Sort(TGreater<int32>());
+	for (int32 HeldOutputIndex : HeldOutputIndices)
+	{
+		Outputs.RemoveAt(HeldOutputIndex);
+	}
+
+	// Release the copied property values as soon as they are consumed
+	Context->ActorSnapshots.Empty();
+
+	return true;
+}
+
 void FPCGCGetActorDataExtendedElement::GatherWaitTasks(AActor* FoundActor, FPCGContext* InContext, TArray<FPCGTaskId>& OutWaitTasks) const
 {
 	if (!FoundActor)
@@ -535,35 +1310,159 @@ void FPCGCGetActorDataExtendedElement::GatherWaitTasks(AActor* FoundActor, FPCGC
 
 void FPCGCGetActorDataExtendedElement::ProcessActors(FPCGContext* Context, const UPCGCGetActorDataExtendedSettings* Settings, const TArray<AActor*>& FoundActors) const
 {
+	const bool bMergeSinglePointData = Settings->Mode == EPCGGetDataFromActorModeExtended::GetSinglePoint && Settings->bMergeSinglePointData && FoundActors.Num() > 1;
+	const bool bCacheSinglePoints = Settings->bCacheActorData && Settings->bGetSpatialData && Settings->Mode == EPCGGetDataFromActorModeExtended::GetSinglePoint && !bMergeSinglePointData && Context->SourceComponent.IsValid();
+	const bool bCacheProperties = Settings->bCacheActorData && Settings->bGetActorProperties && !Settings->bMergeActorProperties;
+	const bool bCacheComponents = Settings->bCacheActorData && Settings->bGetActorComponentsAsPoints && !Settings->bMergeComponentsPoints;
+
+	// The actor state is hashed once, for all the cached outputs of the actor
+	TArray<uint64> ActorCacheKeys;
+	if (bCacheSinglePoints || bCacheProperties || bCacheComponents)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FPCGCGetActorDataExtendedElement::ComputeActorCacheKeys);
+
+		PCGDataFromActorHelpers::GetActorCache().SetMemoryBudget(int64(FMath::Max(PCGDataFromActorHelpers::CVarActorCacheBudgetMB.GetValueOnAnyThread(), 0)) * 1024 * 1024);
+
+		ActorCacheKeys.SetNumZeroed(FoundActors.Num());
+		for (int32 ActorIndex = 0; ActorIndex < FoundActors.Num(); ++ActorIndex)
+		{
+			const AActor* Actor = FoundActors[ActorIndex];
+			if (Actor && IsValid(Actor))
+			{
+				ActorCacheKeys[ActorIndex] = PCGDataFromActorHelpers::ComputeActorCacheKey(Settings, Actor);
+			}
+		}
+	}
 
 	if (Settings->bGetSpatialData)
 	{
 		// Special case:
 		// If we're asking for single point with the merge single point data, we can do a more efficient process
-		if (Settings->Mode == EPCGGetDataFromActorModeExtended::GetSinglePoint && Settings->bMergeSinglePointData && FoundActors.Num() > 1)
+		if (bMergeSinglePointData)
 		{
 			MergeActorsIntoPointData(Context, Settings, FoundActors);
 		}
-		else
+		else if (bCacheSinglePoints)
 		{
-			for (AActor* Actor : FoundActors)
+			TArray<FPCGTaggedData>& Outputs = Context->OutputData.TaggedData;
+			int32 NumReusedPoints = 0;
+			int32 NumRebuiltPoints = 0;
+
+			for (int32 ActorIndex = 0; ActorIndex < FoundActors.Num(); ++ActorIndex)
 			{
+				AActor* Actor = FoundActors[ActorIndex];
+				if (!Actor || !IsValid(Actor))
+				{
+					continue;
+				}
+
+				const uint64 CacheKey = FPCGCDataCache::CombineKey(ActorCacheKeys[ActorIndex], PCGDataFromActorHelpers::SinglePointCacheEntry);
+				if (const UPCGData* CachedData = PCGDataFromActorHelpers::GetActorCache().Find(CacheKey, Actor))
+				{
+					FPCGTaggedData& Output = Outputs.Emplace_GetRef();
+					Output.Pin = PCGPinConstants::DefaultOutputLabel;
+					Output.Data = CachedData;
+					Algo::Transform(Actor->Tags, Output.Tags, [](const FName& InName) { return InName.ToString(); });
+					++NumReusedPoints;
+					continue;
+				}
+
+				// Only the single point of the actor is cached, anything else it produced is rebuilt every time
+				const int32 NumOutputs = Outputs.Num();
 				ProcessActor(Context, Settings, Actor);
+				++NumRebuiltPoints;
+
+				if (Outputs.Num() == NumOutputs + 1)
+				{
+					PCGDataFromActorHelpers::GetActorCache().Add(CacheKey, Outputs.Last().Data, Actor);
+				}
 			}
+
+			PCGDataFromActorHelpers::NumReusedOutputs.fetch_add(NumReusedPoints, std::memory_order_relaxed);
+			PCGDataFromActorHelpers::NumRebuiltOutputs.fetch_add(NumRebuiltPoints, std::memory_order_relaxed);
+			PCGE_LOG(Verbose, LogOnly, FText::Format(LOCTEXT("SinglePointCacheInfo", "Actor cache: {0} single points reused, {1} rebuilt"), NumReusedPoints, NumRebuiltPoints));
 		}
-	}
-	if (Settings->bGetActorProperties)
-	{
-		for (AActor* Actor : FoundActors)
+		else
 		{
-			GetActorProperties(Context, Settings, Actor);
+			for (AActor* Actor : FoundActors)
+			{
+				ProcessActor(Context, Settings, Actor);
+			}
 		}
 	}
-	if (Settings->bGetActorComponentsAsPoints)
+
+	// Snapshot what the worker phase needs, the actors are not touched after this point
+	if (Settings->bGetActorProperties || Settings->bGetActorComponentsAsPoints)
 	{
-		for (AActor* Actor : FoundActors)
+		TRACE_CPUPROFILER_EVENT_SCOPE(FPCGCGetActorDataExtendedElement::SnapshotActors);
+
+		FPCGDataFromActorContext* ActorContext = static_cast<FPCGDataFromActorContext*>(Context);
+		ActorContext->ActorSnapshots.Reset(FoundActors.Num());
+
+		// Found actors usually share a handful of classes, resolve the property paths once per class. Unset when the class can't be extracted from.
+		TMap<const UClass*, TOptional<FPCGCResolvedActorProperties>> ResolvedPropertiesPerClass;
+
+		// Components sharing a mesh share its mesh space sockets and vertices
+		TMap<const UStaticMesh*, TSharedPtr<const FPCGCMeshLocalData>> MeshLocalDataCache;
+
+		// Splines, sockets and vertices are always built from the components snapshot, even when the component points are cached
+		const bool bNeedsComponentsSnapshot = Settings->bSampleSplines || Settings->bExtractMeshSockets || Settings->bExtractMeshVertices;
+
+		for (int32 ActorIndex = 0; ActorIndex < FoundActors.Num(); ++ActorIndex)
 		{
-			GetActorComponentsAsPoints(Context, Settings, Actor);
+			AActor* Actor = FoundActors[ActorIndex];
+			if (!Actor || !IsValid(Actor))
+			{
+				continue;
+			}
+
+			FPCGCActorSnapshot& Snapshot = ActorContext->ActorSnapshots.Emplace_GetRef();
+			Snapshot.Actor = FObjectKey(Actor);
+			Snapshot.Tags = Actor->Tags;
+
+			if (Settings->bGetActorProperties && !Settings->PropertiesNames.IsEmpty())
+			{
+				const UClass* ActorClass = Actor->GetClass();
+				TOptional<FPCGCResolvedActorProperties>* ResolvedProperties = ResolvedPropertiesPerClass.Find(ActorClass);
+				if (!ResolvedProperties)
+				{
+					FPCGCResolvedActorProperties NewResolvedProperties;
+					ResolvedProperties = &ResolvedPropertiesPerClass.Add(ActorClass);
+					if (ResolveActorProperties(Context, Settings, ActorClass, NewResolvedProperties))
+					{
+						*ResolvedProperties = MoveTemp(NewResolvedProperties);
+					}
+				}
+
+				if (ResolvedProperties->IsSet())
+				{
+					if (bCacheProperties)
+					{
+						const uint64 CacheKey = FPCGCDataCache::CombineKey(ActorCacheKeys[ActorIndex], PCGDataFromActorHelpers::PropertiesCacheEntry);
+						Snapshot.PropertiesCacheKey = FPCGCDataCache::CombineKey(CacheKey, PCGDataFromActorHelpers::CrcActorProperties(ResolvedProperties->GetValue(), Actor));
+						Snapshot.CachedPropertiesIndex = PCGDataFromActorHelpers::HoldCachedOutput(Context, Snapshot.PropertiesCacheKey, Actor);
+					}
+
+					if (Snapshot.CachedPropertiesIndex == INDEX_NONE)
+					{
+						SnapshotActorProperties(ResolvedProperties->GetValue(), Actor, Snapshot);
+					}
+				}
+			}
+
+			if (Settings->bGetActorComponentsAsPoints)
+			{
+				if (bCacheComponents)
+				{
+					Snapshot.ComponentsCacheKey = FPCGCDataCache::CombineKey(ActorCacheKeys[ActorIndex], PCGDataFromActorHelpers::ComponentsCacheEntry);
+					Snapshot.CachedComponentsIndex = PCGDataFromActorHelpers::HoldCachedOutput(Context, Snapshot.ComponentsCacheKey, Actor);
+				}
+
+				if (Snapshot.CachedComponentsIndex == INDEX_NONE || bNeedsComponentsSnapshot)
+				{
+					SnapshotActorComponents(Context, Settings, Actor, MeshLocalDataCache, Snapshot);
+				}
+			}
 		}
 	}
 
@@ -875,112 +1774,148 @@ void FPCGCGetActorDataExtendedElement::GetDependenciesCrc(const FPCGDataCollecti
 	OutCrc = Crc;
 }
 
-void FPCGCGetActorDataExtendedElement::GetActorProperties(FPCGContext* Context, const UPCGCGetActorDataExtendedSettings* Settings, AActor* FoundActor) const
+FPCGCPropertyValueSnapshot::FPCGCPropertyValueSnapshot(const FProperty* InProperty, const void* InContainer)
+	: Property(InProperty)
 {
-	check(Context);
-	check(Settings);
+	check(Property && InContainer);
 
-	if (!FoundActor || !IsValid(FoundActor) || Settings->PropertiesNames.IsEmpty())
-	{
-		return;
-	}
+	Value = static_cast<uint8*>(FMemory::Malloc(Property->GetSize(), Property->GetMinAlignment()));
+	Property->InitializeValue(Value);
+	Property->CopyCompleteValue(Value, Property->ContainerPtrToValuePtr<void>(InContainer));
+}
 
-	UObject* ObjectToInspect = FoundActor;
-	using ExtractablePropertyTuple = TTuple<FName, const void*, const FProperty*>;
-	TArray<ExtractablePropertyTuple> ExtractableProperties;
+FPCGCPropertyValueSnapshot::~FPCGCPropertyValueSnapshot()
+{
+	Property->DestroyValue(Value);
+	FMemory::Free(Value);
+}
+
+const void* FPCGCPropertyValueSnapshot::GetContainerPtr() const
+{
+	// The property only knows how to find its value from a container, so we hand it a container that would hold the copy at the property offset
+	return Value - Property->GetOffset_ForInternal();
+}
+
+bool FPCGCGetActorDataExtendedElement::ResolveActorProperties(FPCGContext* Context, const UPCGCGetActorDataExtendedSettings* Settings, const UClass* ActorClass, FPCGCResolvedActorProperties& OutResolvedProperties) const
+{
+	check(Context);
+	check(Settings);
+	check(ActorClass);
 
 	const uint64 ExcludePropertyFlags = CPF_DisableEditOnInstance;
 	const uint64 IncludePropertyFlags = CPF_BlueprintVisible;
 
-	if (!Settings->PropertiesNames.IsEmpty()) {
+	//For each property name
+	for (FName PropertyName : Settings->PropertiesNames)
+	{
+		if (PropertyName == NAME_None) {
+			continue;
+		}
 
-		//For each property name
-		for(FName PropertyName : Settings->PropertiesNames)
+		//Try to find property
+		const FProperty* Property = FindFProperty<FProperty>(ActorClass, PropertyName);
+		if (!Property)
 		{
-			if (PropertyName != NAME_None) {
-
-				//Try to find property
-				FProperty* Property = FindFProperty<FProperty>(ObjectToInspect->GetClass(), PropertyName);
-				if (!Property)
-				{
-					PCGE_LOG(Error, GraphAndLog, FText::Format(LOCTEXT("PropertyDoesNotExist", "Property '{0}' does not exist in the found actor"), FText::FromName(PropertyName)));
-					return;
-				}
-			
-				//Check property flags
-				if (Property->HasAnyPropertyFlags(ExcludePropertyFlags) || !Property->HasAnyPropertyFlags(IncludePropertyFlags))
-				{
-					PCGE_LOG(Error, GraphAndLog, FText::Format(LOCTEXT("PropertyExistsButNotVisible", "Property '{0}' does exist in the found actor, but is not visible."), FText::FromName(PropertyName)));
-					return;
-				}
+			PCGE_LOG(Error, GraphAndLog, FText::Format(LOCTEXT("PropertyDoesNotExist", "Property '{0}' does not exist in the found actor"), FText::FromName(PropertyName)));
+			return false;
+		}
 
-				//Process property and add it to the the list of extractable properties
-				if (!PCGAttributeAccessorHelpers::IsPropertyAccessorSupported(Property) && (Property->IsA<FStructProperty>() || Property->IsA<FObjectProperty>())) 
-				{
-					//If property is a struct or Object
-					UScriptStruct* UnderlyingStruct = nullptr;
-					UClass* UnderlyingClass = nullptr;
-					const void* ObjectAddress = nullptr;
+		//Check property flags
+		if (Property->HasAnyPropertyFlags(ExcludePropertyFlags) || !Property->HasAnyPropertyFlags(IncludePropertyFlags))
+		{
+			PCGE_LOG(Error, GraphAndLog, FText::Format(LOCTEXT("PropertyExistsButNotVisible", "Property '{0}' does exist in the found actor, but is not visible."), FText::FromName(PropertyName)));
+			return false;
+		}
 
-					if (FStructProperty* StructProperty = CastField<FStructProperty>(Property))
-					{
-						UnderlyingStruct = StructProperty->Struct;
-						ObjectAddress = StructProperty->ContainerPtrToValuePtr<void>(ObjectToInspect);
-					}
-					else if (FObjectProperty* ObjectProperty = CastField<FObjectProperty>(Property))
-					{
-						UnderlyingClass = ObjectProperty->PropertyClass;
-						ObjectAddress = ObjectProperty->GetObjectPropertyValue_InContainer(ObjectToInspect);
-					}
+		//Process property and add it to the the list of extractable properties
+		if (!PCGAttributeAccessorHelpers::IsPropertyAccessorSupported(Property) && (Property->IsA<FStructProperty>() || Property->IsA<FObjectProperty>()))
+		{
+			//If property is a struct or Object
+			const UScriptStruct* UnderlyingStruct = nullptr;
+			const UClass* UnderlyingClass = nullptr;
 
-					check(UnderlyingStruct || UnderlyingClass);
-					check(ObjectAddress);
+			if (const FStructProperty* StructProperty = CastField<FStructProperty>(Property))
+			{
+				UnderlyingStruct = StructProperty->Struct;
+			}
+			else if (const FObjectProperty* ObjectProperty = CastField<FObjectProperty>(Property))
+			{
+				UnderlyingClass = ObjectProperty->PropertyClass;
+			}
 
-					// Re-use code from overridable params
-					// Limit ourselves to not recurse into more structs.
-					PCGSettingsHelpers::FPCGGetAllOverridableParamsConfig Config;
-					Config.bUseSeed = true;
-					Config.bExcludeSuperProperties = true;
-					Config.MaxStructDepth = 0;
-					// Can only get exposed properties and visible
-					Config.ExcludePropertyFlags = ExcludePropertyFlags;
-					Config.IncludePropertyFlags = IncludePropertyFlags;
+			check(UnderlyingStruct || UnderlyingClass);
 
-					TArray<FPCGSettingsOverridableParam> AllChildProperties = UnderlyingStruct ? PCGSettingsHelpers::GetAllOverridableParams(UnderlyingStruct, Config) : PCGSettingsHelpers::GetAllOverridableParams(UnderlyingClass, Config);
+			// Re-use code from overridable params
+			// Limit ourselves to not recurse into more structs.
+			PCGSettingsHelpers::FPCGGetAllOverridableParamsConfig Config;
+			Config.bUseSeed = true;
+			Config.bExcludeSuperProperties = true;
+			Config.MaxStructDepth = 0;
+			// Can only get exposed properties and visible
+			Config.ExcludePropertyFlags = ExcludePropertyFlags;
+			Config.IncludePropertyFlags = IncludePropertyFlags;
 
+			TArray<FPCGSettingsOverridableParam> AllChildProperties = UnderlyingStruct ? PCGSettingsHelpers::GetAllOverridableParams(UnderlyingStruct, Config) : PCGSettingsHelpers::GetAllOverridableParams(UnderlyingClass, Config);
 
-					for (const FPCGSettingsOverridableParam& Param : AllChildProperties)
+			for (const FPCGSettingsOverridableParam& Param : AllChildProperties)
+			{
+				if (ensure(!Param.PropertiesNames.IsEmpty()))
+				{
+					const FName ChildPropertyName = Param.PropertiesNames[0];
+					if (const FProperty* ChildProperty = (UnderlyingStruct ? UnderlyingStruct->FindPropertyByName(ChildPropertyName) : UnderlyingClass->FindPropertyByName(ChildPropertyName)))
 					{
-						if (ensure(!Param.PropertiesNames.IsEmpty()))
-						{
-							const FName ChildPropertyName = Param.PropertiesNames[0];
-							if (const FProperty* ChildProperty = (UnderlyingStruct ? UnderlyingStruct->FindPropertyByName(ChildPropertyName) : UnderlyingClass->FindPropertyByName(ChildPropertyName)))
-							{
-								// We use authored name as attribute name to avoid issue with noisy property names, like in UUserDefinedStructs, where some random number is appended to the property name.
-								// By default, it will just return the property name anyway.
-								const FString AuthoredName = UnderlyingStruct ? UnderlyingStruct->GetAuthoredNameForField(ChildProperty) : UnderlyingClass->GetAuthoredNameForField(ChildProperty);
-								ExtractableProperties.Emplace(FName(AuthoredName), ObjectAddress, ChildProperty);
-							}
-						}
+						// We use authored name as attribute name to avoid issue with noisy property names, like in UUserDefinedStructs, where some random number is appended to the property name.
+						// By default, it will just return the property name anyway.
+						const FString AuthoredName = UnderlyingStruct ? UnderlyingStruct->GetAuthoredNameForField(ChildProperty) : UnderlyingClass->GetAuthoredNameForField(ChildProperty);
+						OutResolvedProperties.Properties.Add({ FName(AuthoredName), Property, ChildProperty });
 					}
-
 				}
-				else {
+			}
+		}
+		else
+		{
+			//If property is a regular type
+			OutResolvedProperties.Properties.Add({ Property->GetFName(), nullptr, Property });
+		}
+	}
 
-					//If property is a regular type
+	if (OutResolvedProperties.Properties.IsEmpty())
+	{
+		PCGE_LOG(Error, GraphAndLog, LOCTEXT("NoPropertiesFound", "No properties found to extract"));
+		return false;
+	}
 
-					const FName AttributeName = Property->GetFName();
-					ExtractableProperties.Emplace(AttributeName, ObjectToInspect, Property);
-				}
-			}
+	return true;
+}
+
+void FPCGCGetActorDataExtendedElement::SnapshotActorProperties(const FPCGCResolvedActorProperties& ResolvedProperties, AActor* FoundActor, FPCGCActorSnapshot& OutSnapshot) const
+{
+	check(FoundActor);
+
+	OutSnapshot.Properties.Reserve(ResolvedProperties.Properties.Num());
+
+	// Copy the values, the containers belong to the actor and can't be read from the workers
+	for (const FPCGCResolvedActorProperty& ResolvedProperty : ResolvedProperties.Properties)
+	{
+		const void* ContainerPtr = PCGDataFromActorHelpers::GetPropertyContainer(ResolvedProperty, FoundActor);
+
+		// Unset object references have nothing to extract
+		if (!ContainerPtr)
+		{
+			continue;
 		}
 
+		FPCGCActorPropertySnapshot& PropertySnapshot = OutSnapshot.Properties.Emplace_GetRef();
+		PropertySnapshot.AttributeName = ResolvedProperty.AttributeName;
+		PropertySnapshot.Value = MakeShared<FPCGCPropertyValueSnapshot>(ResolvedProperty.Property, ContainerPtr);
 	}
+}
 
-	if (ExtractableProperties.IsEmpty())
+UPCGParamData* FPCGCGetActorDataExtendedElement::GetActorProperties(const FPCGCActorSnapshot& Snapshot, TArray<FName>& OutFailedProperties) const
+{
+	if (Snapshot.Properties.IsEmpty())
 	{
-		PCGE_LOG(Error, GraphAndLog, LOCTEXT("NoPropertiesFound", "No properties found to extract"));
-		return;
+		return nullptr;
 	}
 
 	UPCGParamData* ParamData = NewObject<UPCGParamData>();
@@ -989,84 +1924,147 @@ void FPCGCGetActorDataExtendedElement::GetActorProperties(FPCGContext* Context,
 	PCGMetadataEntryKey EntryKey = Metadata->AddEntry();
 	bool bValidOperation = false;
 
-	for (ExtractablePropertyTuple& ExtractableProperty : ExtractableProperties)
+	for (const FPCGCActorPropertySnapshot& PropertySnapshot : Snapshot.Properties)
 	{
-		const FName AttributeName = ExtractableProperty.Get<0>();
-		const void* ContainerPtr = ExtractableProperty.Get<1>();
-		const FProperty* FinalProperty = ExtractableProperty.Get<2>();
+		const FPCGCPropertyValueSnapshot& Value = *PropertySnapshot.Value;
 
-		if (!Metadata->SetAttributeFromDataProperty(AttributeName, EntryKey, ContainerPtr, FinalProperty, /*bCreate=*/ true))
+		if (!Metadata->SetAttributeFromDataProperty(PropertySnapshot.AttributeName, EntryKey, Value.GetContainerPtr(), Value.Property, /*bCreate=*/ true))
 		{
-			PCGE_LOG(Error, GraphAndLog, FText::Format(LOCTEXT("ErrorCreatingAttribute", "Error while creating an attribute for property '{0}'. Either the property type is not supported by PCG or attribute creation failed."), FText::FromString(FinalProperty->GetName())));
+			OutFailedProperties.Add(Value.Property->GetFName());
 			continue;
 		}
 
 		bValidOperation = true;
 	}
 
-	if (bValidOperation)
-	{
-		TArray<FPCGTaggedData>& Outputs = Context->OutputData.TaggedData;
-		FPCGTaggedData& Output = Outputs.Emplace_GetRef();
-		Output.Pin = Settings->PropertiesPinName;
-		Output.Data = ParamData;
-	}
-
-
-	
+	return bValidOperation ? ParamData : nullptr;
 }
 
-void FPCGCGetActorDataExtendedElement::GetActorComponentsAsPoints(FPCGContext* Context, const UPCGCGetActorDataExtendedSettings* Settings, AActor* FoundActor) const
+UPCGParamData* FPCGCGetActorDataExtendedElement::GetMergedActorProperties(TConstArrayView<FPCGCActorSnapshot> Snapshots, TArray<FName>& OutFailedProperties) const
 {
-	check(Context);
-	check(Settings);
+	TRACE_CPUPROFILER_EVENT_SCOPE(FPCGCGetActorDataExtendedElement::GetMergedActorProperties);
 
-	if (!FoundActor || !IsValid(FoundActor))
+	// Columns in the order of their first appearance, with the actors providing them
+	struct FColumn
 	{
-		return;
+		FName AttributeName;
+		TArray<TPair<int32, const FPCGCPropertyValueSnapshot*>> Rows;
+	};
+
+	TArray<FColumn> Columns;
+	TMap<FName, int32> ColumnIndices;
+
+	for (int32 ActorIndex = 0; ActorIndex < Snapshots.Num(); ++ActorIndex)
+	{
+		for (const FPCGCActorPropertySnapshot& PropertySnapshot : Snapshots[ActorIndex].Properties)
+		{
+			int32* ColumnIndex = ColumnIndices.Find(PropertySnapshot.AttributeName);
+			if (!ColumnIndex)
+			{
+				ColumnIndex = &ColumnIndices.Add(PropertySnapshot.AttributeName, Columns.Num());
+				Columns.Emplace_GetRef().AttributeName = PropertySnapshot.AttributeName;
+			}
+
+			Columns[*ColumnIndex].Rows.Emplace(ActorIndex, PropertySnapshot.Value.Get());
+		}
 	}
 
-	auto NameTagsToStringTags = [](const FName& InName) { return InName.ToString(); };
-	TSet<FString> ActorTags;
-	Algo::Transform(FoundActor->Tags, ActorTags, NameTagsToStringTags);
-	
+	if (Columns.IsEmpty())
+	{
+		return nullptr;
+	}
 
-	using PrimitiveComponentArray = TInlineComponentArray<UPrimitiveComponent*, 4>;
-	PrimitiveComponentArray Primitives;
+	UPCGParamData* ParamData = NewObject<UPCGParamData>();
+	UPCGMetadata* Metadata = ParamData->MutableMetadata();
+	check(Metadata);
 
+	TArray<PCGMetadataEntryKey> EntryKeys;
+	EntryKeys.Reserve(Snapshots.Num());
+	for (int32 ActorIndex = 0; ActorIndex < Snapshots.Num(); ++ActorIndex)
+	{
+		EntryKeys.Add(Metadata->AddEntry());
+	}
 
-	FoundActor->GetComponents(Primitives);
+	bool bValidOperation = false;
 
+	for (const FColumn& Column : Columns)
+	{
+		// The column type is the one of its first value, actors of other classes can hold the same name with another type
+		const FProperty* ColumnProperty = Column.Rows[0].Value->Property;
+		TUniquePtr<const IPCGAttributeAccessor> ColumnAccessor = PCGAttributeAccessorHelpers::CreatePropertyAccessor(ColumnProperty);
+		if (!ColumnAccessor)
+		{
+			OutFailedProperties.Add(ColumnProperty->GetFName());
+			continue;
+		}
 
-	UPCGPointData* PointData = NewObject<UPCGPointData>();
-	TArray<FPCGPoint>& Points = PointData->GetMutablePoints();
+		auto WriteColumn = [&Column, &ColumnAccessor, &EntryKeys, Metadata, &OutFailedProperties](auto Dummy) -> bool
+		{
+			using Type = decltype(Dummy);
 
-	TArray<FPCGTaggedData>& Outputs = Context->OutputData.TaggedData;
-	FPCGTaggedData& Output = Outputs.Emplace_GetRef();
-	Output.Pin = Settings->ComponentsPinName;
-	Output.Tags = ActorTags;
-	Output.Data = PointData;
+			FPCGMetadataAttribute<Type>* Attribute = Metadata->FindOrCreateAttribute<Type>(Column.AttributeName, Type{}, /*bAllowsInterpolation=*/false, /*bOverrideParent=*/false, /*bOverwriteIfTypeMismatch=*/false);
+			if (!Attribute)
+			{
+				return false;
+			}
 
-	TArray<FName> AttributeNames = Settings->ComponentTagAttributeNames;
+			TArray<PCGMetadataEntryKey> RowKeys;
+			TArray<Type> RowValues;
+			RowKeys.Reserve(Column.Rows.Num());
+			RowValues.Reserve(Column.Rows.Num());
 
-	bool bParseTags = !AttributeNames.IsEmpty() ? true : false;
+			for (const TPair<int32, const FPCGCPropertyValueSnapshot*>& Row : Column.Rows)
+			{
+				const FPCGCPropertyValueSnapshot& Value = *Row.Value;
 
-	TArray<FPCGMetadataAttribute<FName>*> Attributes;
+				// Same property means same accessor, only look up another one for rows of other classes
+				TUniquePtr<const IPCGAttributeAccessor> RowAccessor;
+				const IPCGAttributeAccessor* Accessor = ColumnAccessor.Get();
+				if (Value.Property != Column.Rows[0].Value->Property)
+				{
+					RowAccessor = PCGAttributeAccessorHelpers::CreatePropertyAccessor(Value.Property);
+					Accessor = RowAccessor.Get();
+				}
 
-	if (bParseTags) {
+				Type RowValue{};
+				FPCGAttributeAccessorKeysSingleObjectPtr<void> Keys(Value.GetContainerPtr());
+				if (!Accessor || !Accessor->Get<Type>(RowValue, Keys, EPCGAttributeAccessorFlags::StrictType))
+				{
+					OutFailedProperties.Add(Value.Property->GetFName());
+					continue;
+				}
 
-		for (int32 TagIndex = 0; TagIndex < AttributeNames.Num(); TagIndex++)
-		{
-			if (AttributeNames[TagIndex] == NAME_None) {
-				continue;
+				RowKeys.Add(EntryKeys[Row.Key]);
+				RowValues.Add(MoveTemp(RowValue));
 			}
 
-			Attributes.Add(PointData->Metadata->FindOrCreateAttribute<FName>(AttributeNames[TagIndex], NAME_None, /*bAllowInterpolation=*/false, /*bOverrideParent=*/false, /*bOverwriteIfTypeMismatch=*/ false));
-			
-		}
+			Attribute->SetValues(RowKeys, RowValues);
+			return true;
+		};
 
+		if (PCGMetadataAttribute::CallbackWithRightType(ColumnAccessor->GetUnderlyingType(), WriteColumn))
+		{
+			bValidOperation = true;
+		}
+		else
+		{
+			OutFailedProperties.Add(ColumnProperty->GetFName());
+		}
 	}
-		
+
+	return bValidOperation ? ParamData : nullptr;
+}
+
+void FPCGCGetActorDataExtendedElement::SnapshotActorComponents(FPCGContext* Context, const UPCGCGetActorDataExtendedSettings* Settings, AActor* FoundActor, TMap<const UStaticMesh*, TSharedPtr<const FPCGCMeshLocalData>>& MeshLocalDataCache, FPCGCActorSnapshot& OutSnapshot) const
+{
+	check(Settings);
+
+	using PrimitiveComponentArray = TInlineComponentArray<UPrimitiveComponent*, 4>;
+	PrimitiveComponentArray Primitives;
+
+
+	FoundActor->GetComponents(Primitives);
+	OutSnapshot.Components.Reserve(Primitives.Num());
 
 	for (UPrimitiveComponent* PrimitiveComponent : Primitives)
 	{
@@ -1088,42 +2086,443 @@ void FPCGCGetActorDataExtendedElement::GetActorComponentsAsPoints(FPCGContext* C
 				continue;
 			}
 		}
-		
-		FPCGPoint Point;
-		Point.Transform = PrimitiveComponent->GetComponentTransform();
-		Point.SetLocalBounds(PrimitiveComponent->GetLocalBounds().GetBox());		
-		Point.Steepness = 0.5;
-		Point.Density = 1.0;
 
-		FVector Position = Point.Transform.GetLocation();
-		Point.Seed = PCGHelpers::ComputeSeed((int)Position.X, (int)Position.Y, (int)Position.Z);
+		// Sampled splines go to their own output, instead of a point per component
+		if (Settings->bSampleSplines)
+		{
+			if (const USplineComponent* SplineComponent = Cast<USplineComponent>(PrimitiveComponent))
+			{
+				FPCGCSplineSnapshot& SplineSnapshot = OutSnapshot.Splines.Emplace_GetRef();
+				SplineSnapshot.Curves = SplineComponent->SplineCurves;
+				SplineSnapshot.Transform = SplineComponent->GetComponentTransform();
+				SplineSnapshot.DefaultUpVector = SplineComponent->DefaultUpVector;
+				SplineSnapshot.Tags = SplineComponent->ComponentTags;
+				continue;
+			}
+		}
 
+		// Sockets and vertices are extracted in addition to the component point. Instanced components are left out, their sockets would be per instance.
+		if (Settings->bExtractMeshSockets || Settings->bExtractMeshVertices)
+		{
+			const UStaticMeshComponent* StaticMeshComponent = Cast<UStaticMeshComponent>(PrimitiveComponent);
+			const UStaticMesh* StaticMesh = StaticMeshComponent && !StaticMeshComponent->IsA<UInstancedStaticMeshComponent>() ? StaticMeshComponent->GetStaticMesh() : nullptr;
+			if (StaticMesh)
+			{
+				// The per-execution map only keeps the warnings to one per mesh, the data itself is kept across executions
+				TSharedPtr<const FPCGCMeshLocalData>& LocalData = MeshLocalDataCache.FindOrAdd(StaticMesh);
+				if (!LocalData)
+				{
+					const int32 VertexLOD = PCGDataFromActorHelpers::GetResidentVertexLOD(StaticMesh, Settings->VertexLOD);
+					bool bVerticesUnavailable = false;
+					LocalData = PCGDataFromActorHelpers::GetMeshLocalDataCache().FindOrExtract(StaticMesh, Settings->bExtractMeshSockets, Settings->bExtractMeshVertices, VertexLOD, bVerticesUnavailable);
+
+					if (bVerticesUnavailable)
+					{
+						PCGE_LOG(Warning, GraphAndLog, FText::Format(LOCTEXT("MeshVerticesUnavailable", "Vertices of static mesh '{0}' can't be read, enable Allow CPU Access on the mesh to extract them in cooked builds."), FText::FromString(StaticMesh->GetName())));
+					}
+					else if (Settings->bExtractMeshVertices && VertexLOD > Settings->VertexLOD)
+					{
+						PCGE_LOG(Warning, GraphAndLog, FText::Format(LOCTEXT("MeshVertexLODNotResident", "LOD {1} of static mesh '{0}' is not resident, its vertices are read from LOD {2}."), FText::FromString(StaticMesh->GetName()), FText::AsNumber(Settings->VertexLOD), FText::AsNumber(VertexLOD)));
+					}
+				}
 
-		if (bParseTags && !Attributes.IsEmpty()) {
+				FPCGCMeshSnapshot& MeshSnapshot = OutSnapshot.Meshes.Emplace_GetRef();
+				MeshSnapshot.LocalData = LocalData;
+				MeshSnapshot.Transform = StaticMeshComponent->GetComponentTransform();
+				MeshSnapshot.Tags = StaticMeshComponent->ComponentTags;
+			}
+		}
 
-			TArray<FName> ComponentParsedTags;
+		FPCGCComponentSnapshot& ComponentSnapshot = OutSnapshot.Components.Emplace_GetRef();
+		ComponentSnapshot.Transform = PrimitiveComponent->GetComponentTransform();
+		ComponentSnapshot.Tags = PrimitiveComponent->ComponentTags;
 
-			for (int32 TagIndex = 0; TagIndex < AttributeNames.Num(); TagIndex++)
+		// Instances are copied in bulk from the component buffers, each one becomes a point with the bounds of the mesh
+		const UInstancedStaticMeshComponent* InstancedComponent = Settings->bExtractInstances ? Cast<UInstancedStaticMeshComponent>(PrimitiveComponent) : nullptr;
+		if (InstancedComponent)
+		{
+			const UStaticMesh* StaticMesh = InstancedComponent->GetStaticMesh();
+			ComponentSnapshot.LocalBounds = StaticMesh ? StaticMesh->GetBounds().GetBox() : FBox(FVector::ZeroVector, FVector::ZeroVector);
+			ComponentSnapshot.Instances = InstancedComponent->PerInstanceSMData;
+			ComponentSnapshot.InstanceCustomData = InstancedComponent->PerInstanceSMCustomData;
+			ComponentSnapshot.NumCustomDataFloats = InstancedComponent->NumCustomDataFloats;
+			ComponentSnapshot.bIsInstanced = true;
+		}
+		else
+		{
+			ComponentSnapshot.LocalBounds = PrimitiveComponent->GetLocalBounds().GetBox();
+		}
+	}
+}
+
+UPCGPointData* FPCGCGetActorDataExtendedElement::GetComponentsAsPoints(const UPCGCGetActorDataExtendedSettings* Settings, TConstArrayView<FPCGCActorSnapshot> Snapshots, bool bWriteActorTags) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FPCGCGetActorDataExtendedElement::GetComponentsAsPoints);
+
+	check(Settings);
+
+	// Count first, so that every batch writes its own range of the point array.
+	// Instanced components are split in batches, so that a single large component still spreads over the workers.
+	struct FBatch
+	{
+		int32 ActorIndex = 0;
+		int32 ComponentIndex = 0;
+		int32 FirstInstance = 0;
+		int32 NumPoints = 0;
+		int32 FirstPoint = 0;
+	};
+
+	TArray<FBatch> Batches;
+	int32 NumPoints = 0;
+
+	for (int32 ActorIndex = 0; ActorIndex < Snapshots.Num(); ++ActorIndex)
+	{
+		const TArray<FPCGCComponentSnapshot>& Components = Snapshots[ActorIndex].Components;
+		for (int32 ComponentIndex = 0; ComponentIndex < Components.Num(); ++ComponentIndex)
+		{
+			const int32 NumComponentPoints = Components[ComponentIndex].GetNumPoints();
+			for (int32 FirstInstance = 0; FirstInstance < NumComponentPoints; FirstInstance += PCGDataFromActorHelpers::InstanceBatchSize)
 			{
-				if(AttributeNames[TagIndex] == NAME_None){
-					continue;
-				}
-				ComponentParsedTags.Add(!PrimitiveComponent->ComponentTags.IsEmpty() && PrimitiveComponent->ComponentTags.IsValidIndex(TagIndex) ? PrimitiveComponent->ComponentTags[TagIndex] : NAME_None);
+				Batches.Add({ ActorIndex, ComponentIndex, FirstInstance, FMath::Min(PCGDataFromActorHelpers::InstanceBatchSize, NumComponentPoints - FirstInstance), NumPoints + FirstInstance });
+			}
+
+			NumPoints += NumComponentPoints;
+		}
+	}
+
+	UPCGPointData* PointData = NewObject<UPCGPointData>();
+	TArray<FPCGPoint>& Points = PointData->GetMutablePoints();
+	Points.SetNum(NumPoints);
+
+	PCGDataFromActorHelpers::FTagAttributeWriter TagAttributes(PointData, Settings, bWriteActorTags);
+
+	// Custom data attributes, with the index of the custom data float they are mapped from
+	struct FCustomDataAttribute
+	{
+		FPCGMetadataAttribute<float>* Attribute = nullptr;
+		int32 CustomDataIndex = INDEX_NONE;
+		TArray<float> Values;
+	};
+
+	TArray<FCustomDataAttribute> CustomDataAttributes;
+
+	if (Settings->bExtractInstances)
+	{
+		for (int32 CustomDataIndex = 0; CustomDataIndex < Settings->InstanceCustomDataAttributeNames.Num(); CustomDataIndex++)
+		{
+			if (Settings->InstanceCustomDataAttributeNames[CustomDataIndex] == NAME_None) {
+				continue;
 			}
 
+			FCustomDataAttribute& CustomDataAttribute = CustomDataAttributes.Emplace_GetRef();
+			CustomDataAttribute.Attribute = PointData->Metadata->FindOrCreateAttribute<float>(Settings->InstanceCustomDataAttributeNames[CustomDataIndex], 0.0f, /*bAllowInterpolation=*/true, /*bOverrideParent=*/false, /*bOverwriteIfTypeMismatch=*/ false);
+			CustomDataAttribute.CustomDataIndex = CustomDataIndex;
+		}
+	}
+
+	// Attributes with the same name as another one of another type are not written
+	CustomDataAttributes.RemoveAll([](const FCustomDataAttribute& CustomDataAttribute) { return CustomDataAttribute.Attribute == nullptr; });
 
-			Point.MetadataEntry = PointData->Metadata->AddEntry();
+	const bool bHasAttributes = !TagAttributes.IsEmpty() || !CustomDataAttributes.IsEmpty();
 
-			for (int32 AttributeIndex = 0; AttributeIndex < Attributes.Num(); AttributeIndex++)
+	TArray<PCGMetadataEntryKey> EntryKeys;
+	if (bHasAttributes)
+	{
+		EntryKeys = PCGDataFromActorHelpers::AddEntries(PointData->Metadata, NumPoints);
+		TagAttributes.Allocate(NumPoints);
+
+		for (FCustomDataAttribute& CustomDataAttribute : CustomDataAttributes)
+		{
+			CustomDataAttribute.Values.SetNumUninitialized(NumPoints);
+		}
+	}
+
+	ParallelFor(Batches.Num(), [&Snapshots, &Batches, &Points, &EntryKeys, &TagAttributes, &CustomDataAttributes, bHasAttributes](int32 BatchIndex)
+	{
+		const FBatch& Batch = Batches[BatchIndex];
+		const FPCGCActorSnapshot& Snapshot = Snapshots[Batch.ActorIndex];
+		const FPCGCComponentSnapshot& Component = Snapshot.Components[Batch.ComponentIndex];
+
+		for (int32 BatchPointIndex = 0; BatchPointIndex < Batch.NumPoints; ++BatchPointIndex)
+		{
+			const int32 PointIndex = Batch.FirstPoint + BatchPointIndex;
+			const int32 InstanceIndex = Batch.FirstInstance + BatchPointIndex;
+
+			// Instance transforms are relative to the component
+			FPCGPoint& Point = Points[PointIndex];
+			Point.Transform = Component.bIsInstanced ? FTransform(Component.Instances[InstanceIndex].Transform) * Component.Transform : Component.Transform;
+			Point.SetLocalBounds(Component.LocalBounds);
+			Point.Steepness = 0.5;
+			Point.Density = 1.0;
+
+			FVector Position = Point.Transform.GetLocation();
+			Point.Seed = PCGHelpers::ComputeSeed((int)Position.X, (int)Position.Y, (int)Position.Z);
+
+			if (!bHasAttributes)
 			{
-				Attributes[AttributeIndex]->SetValue(Point.MetadataEntry, ComponentParsedTags[AttributeIndex]);
-			}	
+				continue;
+			}
+
+			Point.MetadataEntry = EntryKeys[PointIndex];
+
+			TagAttributes.SetValues(PointIndex, Snapshot.Tags, Component.Tags);
+
+			for (FCustomDataAttribute& CustomDataAttribute : CustomDataAttributes)
+			{
+				const int32 CustomDataIndex = InstanceIndex * Component.NumCustomDataFloats + CustomDataAttribute.CustomDataIndex;
+				const bool bHasCustomData = Component.bIsInstanced && CustomDataAttribute.CustomDataIndex < Component.NumCustomDataFloats && Component.InstanceCustomData.IsValidIndex(CustomDataIndex);
+				CustomDataAttribute.Values[PointIndex] = bHasCustomData ? Component.InstanceCustomData[CustomDataIndex] : 0.0f;
+			}
 		}
+	});
 
-		Points.Add(Point);
-		
+	TagAttributes.Write(EntryKeys);
+
+	for (const FCustomDataAttribute& CustomDataAttribute : CustomDataAttributes)
+	{
+		CustomDataAttribute.Attribute->SetValues(EntryKeys, CustomDataAttribute.Values);
+	}
+
+	return PointData;
+}
+
+UPCGPointData* FPCGCGetActorDataExtendedElement::GetSplinesAsPoints(const UPCGCGetActorDataExtendedSettings* Settings, TConstArrayView<FPCGCActorSnapshot> Snapshots) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FPCGCGetActorDataExtendedElement::GetSplinesAsPoints);
+
+	check(Settings);
+
+	// Count first, so that every spline writes its own range of the point array
+	struct FSpline
+	{
+		int32 ActorIndex = 0;
+		const FPCGCSplineSnapshot* Spline = nullptr;
+		int32 NumPoints = 0;
+		int32 FirstPoint = 0;
+	};
+
+	TArray<FSpline> Splines;
+	int32 NumPoints = 0;
+
+	for (int32 ActorIndex = 0; ActorIndex < Snapshots.Num(); ++ActorIndex)
+	{
+		for (const FPCGCSplineSnapshot& Spline : Snapshots[ActorIndex].Splines)
+		{
+			const int32 NumSplinePoints = PCGDataFromActorHelpers::GetNumSplineSamples(Settings, Spline);
+			Splines.Add({ ActorIndex, &Spline, NumSplinePoints, NumPoints });
+			NumPoints += NumSplinePoints;
+		}
+	}
+
+	UPCGPointData* PointData = NewObject<UPCGPointData>();
+	TArray<FPCGPoint>& Points = PointData->GetMutablePoints();
+	Points.SetNum(NumPoints);
+
+	PCGDataFromActorHelpers::FTagAttributeWriter TagAttributes(PointData, Settings, /*bWriteActorTags=*/true);
+
+	FPCGMetadataAttribute<int32>* SplineIndexAttribute = nullptr;
+	TArray<int32> SplineIndices;
+	if (Settings->SplineIndexAttributeName != NAME_None)
+	{
+		SplineIndexAttribute = PointData->Metadata->FindOrCreateAttribute<int32>(Settings->SplineIndexAttributeName, INDEX_NONE, /*bAllowInterpolation=*/false, /*bOverrideParent=*/false, /*bOverwriteIfTypeMismatch=*/ false);
+	}
+
+	const bool bHasAttributes = !TagAttributes.IsEmpty() || SplineIndexAttribute;
+
+	TArray<PCGMetadataEntryKey> EntryKeys;
+	if (bHasAttributes)
+	{
+		EntryKeys = PCGDataFromActorHelpers::AddEntries(PointData->Metadata, NumPoints);
+		TagAttributes.Allocate(NumPoints);
+
+		if (SplineIndexAttribute)
+		{
+			SplineIndices.SetNumUninitialized(NumPoints);
+		}
+	}
+
+	ParallelFor(Splines.Num(), [Settings, &Snapshots, &Splines, &Points, &EntryKeys, &TagAttributes, &SplineIndices, bHasAttributes](int32 SplineIndex)
+	{
+		const FSpline& Spline = Splines[SplineIndex];
+		const FPCGCActorSnapshot& Snapshot = Snapshots[Spline.ActorIndex];
+
+		for (int32 SampleIndex = 0; SampleIndex < Spline.NumPoints; ++SampleIndex)
+		{
+			const int32 PointIndex = Spline.FirstPoint + SampleIndex;
+
+			FPCGPoint& Point = Points[PointIndex];
+			Point.Transform = PCGDataFromActorHelpers::GetSplineSampleTransform(Settings, *Spline.Spline, SampleIndex, Spline.NumPoints);
+			Point.Steepness = 0.5;
+			Point.Density = 1.0;
+
+			FVector Position = Point.Transform.GetLocation();
+			Point.Seed = PCGHelpers::ComputeSeed((int)Position.X, (int)Position.Y, (int)Position.Z);
+
+			if (!bHasAttributes)
+			{
+				continue;
+			}
+
+			Point.MetadataEntry = EntryKeys[PointIndex];
+
+			TagAttributes.SetValues(PointIndex, Snapshot.Tags, Spline.Spline->Tags);
+
+			if (!SplineIndices.IsEmpty())
+			{
+				SplineIndices[PointIndex] = SplineIndex;
+			}
+		}
+	});
+
+	TagAttributes.Write(EntryKeys);
+
+	if (SplineIndexAttribute)
+	{
+		SplineIndexAttribute->SetValues(EntryKeys, SplineIndices);
+	}
+
+	return PointData;
+}
+
+UPCGPointData* FPCGCGetActorDataExtendedElement::GetMeshesAsPoints(const UPCGCGetActorDataExtendedSettings* Settings, TConstArrayView<FPCGCActorSnapshot> Snapshots, bool bVertices) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FPCGCGetActorDataExtendedElement::GetMeshesAsPoints);
+
+	check(Settings);
+
+	// Count first, so that every batch writes its own range of the point array
+	struct FBatch
+	{
+		int32 ActorIndex = 0;
+		int32 MeshIndex = 0;
+		int32 FirstElement = 0;
+		int32 NumPoints = 0;
+		int32 FirstPoint = 0;
+	};
+
+	TArray<FBatch> Batches;
+	int32 NumPoints = 0;
+
+	for (int32 ActorIndex = 0; ActorIndex < Snapshots.Num(); ++ActorIndex)
+	{
+		const TArray<FPCGCMeshSnapshot>& Meshes = Snapshots[ActorIndex].Meshes;
+		for (int32 MeshIndex = 0; MeshIndex < Meshes.Num(); ++MeshIndex)
+		{
+			const FPCGCMeshLocalData& LocalData = *Meshes[MeshIndex].LocalData;
+			const int32 NumMeshPoints = bVertices ? LocalData.VertexPositions.Num() : LocalData.SocketTransforms.Num();
+			for (int32 FirstElement = 0; FirstElement < NumMeshPoints; FirstElement += PCGDataFromActorHelpers::InstanceBatchSize)
+			{
+				Batches.Add({ ActorIndex, MeshIndex, FirstElement, FMath::Min(PCGDataFromActorHelpers::InstanceBatchSize, NumMeshPoints - FirstElement), NumPoints + FirstElement });
+			}
+
+			NumPoints += NumMeshPoints;
+		}
+	}
+
+	UPCGPointData* PointData = NewObject<UPCGPointData>();
+	TArray<FPCGPoint>& Points = PointData->GetMutablePoints();
+	Points.SetNum(NumPoints);
+
+	PCGDataFromActorHelpers::FTagAttributeWriter TagAttributes(PointData, Settings, /*bWriteActorTags=*/true);
+
+	FPCGMetadataAttribute<FName>* SocketAttribute = nullptr;
+	FPCGMetadataAttribute<FVector>* NormalAttribute = nullptr;
+	TArray<FName> SocketNames;
+	TArray<FVector> Normals;
+
+	if (!bVertices && Settings->SocketAttributeName != NAME_None)
+	{
+		SocketAttribute = PointData->Metadata->FindOrCreateAttribute<FName>(Settings->SocketAttributeName, NAME_None, /*bAllowInterpolation=*/false, /*bOverrideParent=*/false, /*bOverwriteIfTypeMismatch=*/ false);
+	}
+	else if (bVertices && Settings->NormalAttributeName != NAME_None)
+	{
+		NormalAttribute = PointData->Metadata->FindOrCreateAttribute<FVector>(Settings->NormalAttributeName, FVector::UpVector, /*bAllowInterpolation=*/true, /*bOverrideParent=*/false, /*bOverwriteIfTypeMismatch=*/ false);
+	}
+
+	const bool bHasAttributes = !TagAttributes.IsEmpty() || SocketAttribute || NormalAttribute;
+
+	TArray<PCGMetadataEntryKey> EntryKeys;
+	if (bHasAttributes)
+	{
+		EntryKeys = PCGDataFromActorHelpers::AddEntries(PointData->Metadata, NumPoints);
+		TagAttributes.Allocate(NumPoints);
+
+		if (SocketAttribute)
+		{
+			SocketNames.SetNumUninitialized(NumPoints);
+		}
+
+		if (NormalAttribute)
+		{
+			Normals.SetNumUninitialized(NumPoints);
+		}
+	}
+
+	ParallelFor(Batches.Num(), [&Snapshots, &Batches, &Points, &EntryKeys, &TagAttributes, &SocketNames, &Normals, bVertices, bHasAttributes](int32 BatchIndex)
+	{
+		const FBatch& Batch = Batches[BatchIndex];
+		const FPCGCActorSnapshot& Snapshot = Snapshots[Batch.ActorIndex];
+		const FPCGCMeshSnapshot& Mesh = Snapshot.Meshes[Batch.MeshIndex];
+		const FPCGCMeshLocalData& LocalData = *Mesh.LocalData;
+
+		// Normals go through the inverse transpose of the component transform
+		const FVector InverseScale = FTransform::GetSafeScaleReciprocal(Mesh.Transform.GetScale3D());
+
+		for (int32 BatchPointIndex = 0; BatchPointIndex < Batch.NumPoints; ++BatchPointIndex)
+		{
+			const int32 PointIndex = Batch.FirstPoint + BatchPointIndex;
+			const int32 ElementIndex = Batch.FirstElement + BatchPointIndex;
+
+			// Local space data is shared by every component of the mesh, only the component transform is applied here
+			FPCGPoint& Point = Points[PointIndex];
+			if (bVertices)
+			{
+				Point.Transform = FTransform(Mesh.Transform.GetRotation(), Mesh.Transform.TransformPosition(FVector(LocalData.VertexPositions[ElementIndex])));
+			}
+			else
+			{
+				Point.Transform = LocalData.SocketTransforms[ElementIndex] * Mesh.Transform;
+			}
+
+			Point.Steepness = 0.5;
+			Point.Density = 1.0;
+
+			FVector Position = Point.Transform.GetLocation();
+			Point.Seed = PCGHelpers::ComputeSeed((int)Position.X, (int)Position.Y, (int)Position.Z);
+
+			if (!bHasAttributes)
+			{
+				continue;
+			}
+
+			Point.MetadataEntry = EntryKeys[PointIndex];
+			TagAttributes.SetValues(PointIndex, Snapshot.Tags, Mesh.Tags);
+
+			if (!SocketNames.IsEmpty())
+			{
+				SocketNames[PointIndex] = LocalData.SocketNames[ElementIndex];
+			}
+
+			if (!Normals.IsEmpty())
+			{
+				Normals[PointIndex] = Mesh.Transform.GetRotation().RotateVector(FVector(LocalData.VertexNormals[ElementIndex]) * InverseScale).GetSafeNormal();
+			}
+		}
+	});
+
+	TagAttributes.Write(EntryKeys);
+
+	if (SocketAttribute)
+	{
+		SocketAttribute->SetValues(EntryKeys, SocketNames);
+	}
+
+	if (NormalAttribute)
+	{
+		NormalAttribute->SetValues(EntryKeys, Normals);
 	}
 
+	return PointData;
 }
 
 #undef LOCTEXT_NAMESPACE
@@ -0,0 +1,143 @@
+// Copyright Roman K. All Rights Reserved.
+
+#include "PCGCMemoizedSpatialData.h"
+
+#include "Data/PCGPointData.h"
+#include "Helpers/PCGHelpers.h"
+#include "Metadata/PCGMetadata.h"
+
+#include "Serialization/ArchiveCrc32.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(PCGCMemoizedSpatialData)
+
+void UPCGCMemoizedSpatialData::Initialize(const UPCGSpatialData* InData, double InQuantization, int32 InMaxEntries)
+{
+	check(InData);
+	Inner = InData;
+	Quantization = FMath::Max(InQuantization, UE_KINDA_SMALL_NUMBER);
+	MaxEntries = FMath::Max(InMaxEntries, NumShards);
+
+	InitializeFromData(InData);
+}
+
+int32 UPCGCMemoizedSpatialData::GetNumEntries() const
+{
+	int32 NumEntries = 0;
+	for (FShard& Shard : Shards)
+	{
+		FReadScopeLock ReadLock(Shard.Lock);
+		NumEntries += Shard.Samples.Num();
+	}
+
+	return NumEntries;
+}
+
+void UPCGCMemoizedSpatialData::AddToCrc(FArchiveCrc32& Ar, bool bFullDataCrc) const
+{
+	//Samples are the ones of the inner data, so is the CRC
+	uint32 InnerCrc = Inner ? Inner->GetOrComputeCrc(bFullDataCrc).GetValue() : 0;
+	Ar << InnerCrc;
+}
+
+UPCGCMemoizedSpatialData::FSampleKey UPCGCMemoizedSpatialData::ComputeKey(const FTransform& Transform, const FBox& Bounds) const
+{
+	const double InvQuantization = 1.0 / Quantization;
+
+	auto Quantize = [InvQuantization](const FVector& Value)
+	{
+		return FInt64Vector(
+			FMath::RoundToInt64(Value.X * InvQuantization),
+			FMath::RoundToInt64(Value.Y * InvQuantization),
+			FMath::RoundToInt64(Value.Z * InvQuantization));
+	};
+
+	auto HashVector = [](const FInt64Vector& Value)
+	{
+		return HashCombineFast(HashCombineFast(GetTypeHash(Value.X), GetTypeHash(Value.Y)), GetTypeHash(Value.Z));
+	};
+
+	//Rotation and scale are not quantized on the spatial step, they are compared as is
+	FSampleKey Key;
+	Key.Location = Quantize(Transform.GetLocation());
+	Key.BoundsMin = Quantize(Bounds.Min);
+	Key.BoundsMax = Quantize(Bounds.Max);
+	Key.Rotation = Transform.GetRotation();
+	Key.Scale = Transform.GetScale3D();
+
+	const uint32 BoundsHash = HashCombineFast(HashVector(Key.BoundsMin), HashVector(Key.BoundsMax));
+	const uint32 ShapeHash = HashCombineFast(GetTypeHash(Key.Rotation), GetTypeHash(Key.Scale));
+	Key.Hash = HashCombineFast(HashVector(Key.Location), HashCombineFast(BoundsHash, ShapeHash));
+
+	return Key;
+}
+
+void UPCGCMemoizedSpatialData::MakePoint(const FTransform& Transform, const FBox& Bounds, const FSample& Sample, FPCGPoint& OutPoint)
+{
+	//The sample may come from another location in the same quantization step, the point itself belongs to this caller.
+	//The seed is derived from the position, like the built-in samplers do.
+	OutPoint = FPCGPoint(Transform, Sample.Density, PCGHelpers::ComputeSeedFromPosition(Transform.GetLocation()));
+	OutPoint.SetLocalBounds(Bounds);
+	OutPoint.Color = Sample.Color;
+	OutPoint.Steepness = Sample.Steepness;
+}
+
+bool UPCGCMemoizedSpatialData::SamplePoint(const FTransform& Transform, const FBox& Bounds, FPCGPoint& OutPoint, UPCGMetadata* OutMetadata) const
+{
+	check(Inner);
+
+	//Samples with an output metadata create entries in the caller's metadata, they can't be shared
+	if (OutMetadata)
+	{
+		return Inner->SamplePoint(Transform, Bounds, OutPoint, OutMetadata);
+	}
+
+	const FSampleKey Key = ComputeKey(Transform, Bounds);
+	FShard& Shard = Shards[Key.Hash % NumShards];
+
+	{
+		FReadScopeLock ReadLock(Shard.Lock);
+		if (const FSample* Sample = Shard.Samples.Find(Key))
+		{
+			NumHits.fetch_add(1, std::memory_order_relaxed);
+			MakePoint(Transform, Bounds, *Sample, OutPoint);
+			return Sample->bInside;
+		}
+	}
+
+	FPCGPoint InnerPoint;
+	const bool bInside = Inner->SamplePoint(Transform, Bounds, InnerPoint, OutMetadata);
+	const FSample Sample{ InnerPoint.Color, InnerPoint.Density, InnerPoint.Steepness, bInside };
+
+	//Built the same way as on a hit, so the point doesn't depend on which sampler filled the cache first
+	MakePoint(Transform, Bounds, Sample, OutPoint);
+
+	{
+		FWriteScopeLock WriteLock(Shard.Lock);
+
+		//Bounded by dropping the whole shard, the samples of a single pass are usually close to each other anyway
+		if (Shard.Samples.Num() >= MaxEntries / NumShards)
+		{
+			Shard.Samples.Reset();
+		}
+
+		Shard.Samples.Add(Key, Sample);
+	}
+
+	return bInside;
+}
+
+const UPCGPointData* UPCGCMemoizedSpatialData::ToPointData(FPCGContext* Context, const FBox& InBounds) const
+{
+	check(Inner);
+	return Inner->ToPointData(Context, InBounds);
+}
+
+UPCGSpatialData* UPCGCMemoizedSpatialData::CopyInternal() const
+{
+	UPCGCMemoizedSpatialData* NewData = NewObject<UPCGCMemoizedSpatialData>();
+	NewData->Inner = Inner;
+	NewData->Quantization = Quantization;
+	NewData->MaxEntries = MaxEntries;
+
+	return NewData;
+}
@@ -3,13 +3,25 @@
 
 #include "PCGCSelectPointsCustom.h"
 
+#include "PCGCDataCache.h"
+#include "PCGComponent.h"
 #include "PCGContext.h"
+#include "PCGModule.h"
 #include "Data/PCGSpatialData.h"
 #include "Data/PCGPointData.h"
 #include "Helpers/PCGAsync.h"
 #include "Helpers/PCGHelpers.h"
+#include "Metadata/Accessors/IPCGAttributeAccessor.h"
+#include "Metadata/Accessors/PCGAttributeAccessorHelpers.h"
 
+#include "Algo/Sort.h"
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
 #include "Math/RandomStream.h"
+#include "UObject/ObjectKey.h"
+
+#include <algorithm>
+#include <atomic>
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(PCGCSelectPointsCustom)
 
@@ -21,6 +33,488 @@ namespace PCGCSelectPointsCustomSettings
 	static const FName DiscardedPointsLabel = TEXT("DiscardedPoints");
 }
 
+namespace PCGCSelectPointsCustomHelpers
+{
+	static TAutoConsoleVariable<int32> CVarConversionCacheBudgetMB(
+		TEXT("pcgc.SplitPoints.ConversionCacheBudgetMB"),
+		256,
+		TEXT("Memory budget in MB of the point data conversion cache shared by the Split Points nodes of a graph execution."));
+
+	/** Point data converted from non-point inputs, shared by the Split Points nodes of the same graph execution. */
+	static FPCGCDataCache& GetConversionCache()
+	{
+		static FPCGCDataCache ConversionCache(TEXT("PCGCSplitPointsConversionCache"));
+		return ConversionCache;
+	}
+
+	static FAutoConsoleCommand CommandConversionCacheStats(
+		TEXT("pcgc.SplitPoints.ConversionCacheStats"),
+		TEXT("Logs the hit and miss counters of the Split Points conversion cache."),
+		FConsoleCommandDelegate::CreateLambda([]()
+		{
+			const FPCGCDataCacheStats Stats = GetConversionCache().GetStats();
+			UE_LOG(LogPCG, Log, TEXT("Split Points conversion cache: %lld hits, %lld misses, %lld evictions, %d entries, %.2f MB"), Stats.Hits, Stats.Misses, Stats.Evictions, Stats.NumEntries, Stats.MemorySize / (1024.0 * 1024.0));
+		}));
+
+	static FAutoConsoleCommand CommandClearConversionCache(
+		TEXT("pcgc.SplitPoints.ClearConversionCache"),
+		TEXT("Empties the Split Points conversion cache."),
+		FConsoleCommandDelegate::CreateLambda([]()
+		{
+			GetConversionCache().Reset();
+		}));
+
+	/** Conversions done during the current generation of a source component. */
+	struct FComponentConversions
+	{
+		FPCGTaskId GenerationTaskId = InvalidPCGTaskId;
+		TArray<uint64> Keys;
+	};
+
+	/** Records the conversion, and releases the conversions of the previous generations of the component and of the destroyed components. */
+	static void TrackConversion(const UPCGComponent* SourceComponent, FPCGTaskId GenerationTaskId, uint64 Key)
+	{
+		static FCriticalSection ConversionsLock;
+		static TMap<TObjectKey<UPCGComponent>, FComponentConversions> ConversionsPerComponent;
+
+		const TObjectKey<UPCGComponent> ComponentKey(SourceComponent);
+		TArray<uint64> StaleKeys;
+
+		{
+			FScopeLock ScopeLock(&ConversionsLock);
+
+			if (!ConversionsPerComponent.Contains(ComponentKey))
+			{
+				for (auto It = ConversionsPerComponent.CreateIterator(); It; ++It)
+				{
+					if (!It.Key().ResolveObjectPtr())
+					{
+						StaleKeys.Append(It.Value().Keys);
+						It.RemoveCurrent();
+					}
+				}
+			}
+
+			FComponentConversions& Conversions = ConversionsPerComponent.FindOrAdd(ComponentKey);
+			if (Conversions.GenerationTaskId != GenerationTaskId)
+			{
+				StaleKeys.Append(Conversions.Keys);
+				Conversions.Keys.Reset();
+				Conversions.GenerationTaskId = GenerationTaskId;
+			}
+
+			Conversions.Keys.Add(Key);
+		}
+
+		for (uint64 StaleKey : StaleKeys)
+		{
+			GetConversionCache().Remove(StaleKey);
+		}
+	}
+
+	/**
+	 * Converts the input to point data. Non-point inputs go through the shared conversion cache, keyed on the generation of the source component and the data UID,
+	 * so a conversion is only reused by the nodes of the same graph execution. Data UIDs are never reused, and the conversion always samples the full data bounds,
+	 * so there are no other sampling parameters to key on.
+	 */
+	static const UPCGPointData* ToPointData(FPCGContext* Context, const UPCGSpatialData* SpatialData, bool bUseCache)
+	{
+		if (const UPCGPointData* PointData = Cast<UPCGPointData>(SpatialData))
+		{
+			return PointData;
+		}
+
+		const UPCGComponent* SourceComponent = Context->SourceComponent.Get();
+		const FPCGTaskId GenerationTaskId = SourceComponent ? SourceComponent->GetGenerationTaskId() : InvalidPCGTaskId;
+
+		// Outside of a generation there is no execution to scope the conversion to
+		if (!bUseCache || GenerationTaskId == InvalidPCGTaskId)
+		{
+			return SpatialData->ToPointData(Context);
+		}
+
+		FPCGCDataCache& Cache = GetConversionCache();
+		Cache.SetMemoryBudget(int64(FMath::Max(CVarConversionCacheBudgetMB.GetValueOnAnyThread(), 0)) * 1024 * 1024);
+
+		uint64 Key = FPCGCDataCache::CombineKey(GetTypeHash(FObjectKey(SourceComponent)), GenerationTaskId);
+		Key = FPCGCDataCache::CombineKey(Key, SpatialData->UID);
+
+		if (const UPCGPointData* CachedData = Cast<UPCGPointData>(Cache.Find(Key)))
+		{
+			return CachedData;
+		}
+
+		const UPCGPointData* PointData = SpatialData->ToPointData(Context);
+		if (PointData)
+		{
+			Cache.Add(Key, PointData);
+			TrackConversion(SourceComponent, GenerationTaskId, Key);
+		}
+
+		return PointData;
+	}
+
+	/** Same per-point chance as the random path, so both modes agree on which points are "first" to be picked. */
+	static float GetPointChance(int32 Seed, const FPCGPoint& Point)
+	{
+		FRandomStream RandomSource(PCGHelpers::ComputeSeed(Seed, Point.Seed));
+		return RandomSource.FRand();
+	}
+
+	/**
+	 * Stratified selection: points are hashed into the cells of a CellSize grid, grouped per cell with a counting sort,
+	 * and each cell keeps Ratio of its points (lowest chances first). The fractional part of Ratio * CellCount is resolved
+	 * with a per-cell random draw, so the expected selected count matches the random path.
+	 */
+	static void ComputeStratifiedSelection(const TArray<FPCGPoint>& Points, const FVector& CellSize, float Ratio, int32 Seed, bool bParallel, TArray<bool>& OutSelected)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FPCGCSelectPointsCustomElement::Execute::ComputeStratifiedSelection);
+
+		const EParallelForFlags ParallelForFlags = bParallel ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread;
+		const int32 NumPoints = Points.Num();
+		const FVector InvCellSize = FVector::OneVector / FVector::Max(CellSize, FVector(UE_KINDA_SMALL_NUMBER));
+
+		TArray<FIntVector> CellKeys;
+		CellKeys.SetNumUninitialized(NumPoints);
+
+		TArray<float> Chances;
+		Chances.SetNumUninitialized(NumPoints);
+
+		ParallelFor(NumPoints, [&Points, &CellKeys, &Chances, &InvCellSize, Seed](int32 Index)
+		{
+			const FVector Location = Points[Index].Transform.GetLocation() * InvCellSize;
+			CellKeys[Index] = FIntVector(FMath::FloorToInt32(Location.X), FMath::FloorToInt32(Location.Y), FMath::FloorToInt32(Location.Z));
+			Chances[Index] = GetPointChance(Seed, Points[Index]);
+		}, ParallelForFlags);
+
+		//Map sparse cell keys to dense cell indices and count the points in each cell
+		TMap<FIntVector, int32> CellIndices;
+		TArray<FIntVector> Cells;
+		TArray<int32> PointCells;
+		TArray<int32> CellOffsets;
+		PointCells.SetNumUninitialized(NumPoints);
+
+		for (int32 Index = 0; Index < NumPoints; ++Index)
+		{
+			int32& CellIndex = CellIndices.FindOrAdd(CellKeys[Index], INDEX_NONE);
+			if (CellIndex == INDEX_NONE)
+			{
+				CellIndex = Cells.Add(CellKeys[Index]);
+				CellOffsets.Add(0);
+			}
+
+			PointCells[Index] = CellIndex;
+			++CellOffsets[CellIndex];
+		}
+
+		const int32 NumCells = Cells.Num();
+
+		//Exclusive prefix sum, CellOffsets[i] becomes the start of cell i, with a sentinel at the end
+		int32 Running = 0;
+		for (int32& Offset : CellOffsets)
+		{
+			const int32 Count = Offset;
+			Offset = Running;
+			Running += Count;
+		}
+		CellOffsets.Add(Running);
+
+		//Counting sort scatter, stable so the point order inside each cell follows the input order
+		TArray<int32> SortedPoints;
+		SortedPoints.SetNumUninitialized(NumPoints);
+		{
+			TArray<int32> WriteOffsets(CellOffsets.GetData(), NumCells);
+			for (int32 Index = 0; Index < NumPoints; ++Index)
+			{
+				SortedPoints[WriteOffsets[PointCells[Index]]++] = Index;
+			}
+		}
+
+		OutSelected.Init(false, NumPoints);
+
+		//Cells own disjoint ranges of SortedPoints and OutSelected entries, so they can be processed in parallel
+		ParallelFor(NumCells, [&Cells, &CellOffsets, &SortedPoints, &Chances, &OutSelected, Ratio, Seed](int32 CellIndex)
+		{
+			const int32 Begin = CellOffsets[CellIndex];
+			const int32 Count = CellOffsets[CellIndex + 1] - Begin;
+
+			const double Target = double(Count) * Ratio;
+			int32 NumToSelect = FMath::FloorToInt32(Target);
+
+			const FIntVector& Cell = Cells[CellIndex];
+			FRandomStream CellRandomSource(PCGHelpers::ComputeSeed(Seed, PCGHelpers::ComputeSeed(Cell.X, Cell.Y, Cell.Z)));
+			if (CellRandomSource.FRand() < Target - NumToSelect)
+			{
+				++NumToSelect;
+			}
+
+			NumToSelect = FMath::Min(NumToSelect, Count);
+			if (NumToSelect <= 0)
+			{
+				return;
+			}
+
+			TArrayView<int32> CellPoints(SortedPoints.GetData() + Begin, Count);
+			if (NumToSelect < Count)
+			{
+				Algo::Sort(CellPoints, [&Chances](int32 A, int32 B) { return Chances[A] < Chances[B] || (Chances[A] == Chances[B] && A < B); });
+			}
+
+			for (int32 Index = 0; Index < NumToSelect; ++Index)
+			{
+				OutSelected[CellPoints[Index]] = true;
+			}
+		}, ParallelForFlags);
+	}
+
+	/** Number of points read per accessor call, and the chunk size of the parallel Top-K candidate pass. */
+	static constexpr int32 TopKChunkSize = 16384;
+
+	/**
+	 * Reads the ranking attribute of every point as doubles, in bulk chunks. NaNs are replaced by the worst possible value
+	 * so the ranking stays a strict weak order.
+	 */
+	static bool ReadRankingValues(const UPCGPointData* PointData, const FPCGAttributePropertyInputSelector& InSelector, bool bSelectLowest, TArray<double>& OutValues)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FPCGCSelectPointsCustomElement::Execute::ReadRankingValues);
+
+		const FPCGAttributePropertyInputSelector Selector = InSelector.CopyAndFixLast(PointData);
+		TUniquePtr<const IPCGAttributeAccessor> Accessor = PCGAttributeAccessorHelpers::CreateConstAccessor(PointData, Selector);
+		TUniquePtr<const IPCGAttributeAccessorKeys> Keys = PCGAttributeAccessorHelpers::CreateConstKeys(PointData, Selector);
+
+		if (!Accessor || !Keys)
+		{
+			return false;
+		}
+
+		const int32 NumPoints = PointData->GetPoints().Num();
+		const int32 NumChunks = FMath::DivideAndRoundUp(NumPoints, TopKChunkSize);
+		OutValues.SetNumUninitialized(NumPoints);
+
+		const double WorstValue = bSelectLowest ? TNumericLimits<double>::Max() : TNumericLimits<double>::Lowest();
+		std::atomic<bool> bSuccess = true;
+
+		ParallelFor(NumChunks, [&Accessor, &Keys, &OutValues, &bSuccess, NumPoints, WorstValue](int32 ChunkIndex)
+		{
+			const int32 Start = ChunkIndex * TopKChunkSize;
+			const int32 Count = FMath::Min(TopKChunkSize, NumPoints - Start);
+			TArrayView<double> ChunkValues(OutValues.GetData() + Start, Count);
+
+			if (!Accessor->GetRange<double>(ChunkValues, Start, *Keys, EPCGAttributeAccessorFlags::AllowBroadcast))
+			{
+				bSuccess = false;
+				return;
+			}
+
+			for (double& Value : ChunkValues)
+			{
+				if (FMath::IsNaN(Value))
+				{
+					Value = WorstValue;
+				}
+			}
+		});
+
+		return bSuccess;
+	}
+
+	/**
+	 * Top-K selection as a parallel nth-element partition: every chunk keeps its own K best candidates, and the global K best
+	 * are then partitioned out of the union of those candidates. Ties break on the point seed, then on the point index.
+	 */
+	static void ComputeTopKSelection(const TArray<FPCGPoint>& Points, const TArray<double>& Values, int32 K, bool bSelectLowest, bool bParallel, TArray<bool>& OutSelected)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FPCGCSelectPointsCustomElement::Execute::ComputeTopKSelection);
+
+		const int32 NumPoints = Points.Num();
+		K = FMath::Clamp(K, 0, NumPoints);
+
+		OutSelected.Init(K == NumPoints, NumPoints);
+		if (K == 0 || K == NumPoints)
+		{
+			return;
+		}
+
+		auto IsBetter = [&Points, &Values, bSelectLowest](int32 A, int32 B)
+		{
+			if (Values[A] != Values[B])
+			{
+				return bSelectLowest ? Values[A] < Values[B] : Values[A] > Values[B];
+			}
+
+			if (Points[A].Seed != Points[B].Seed)
+			{
+				return Points[A].Seed < Points[B].Seed;
+			}
+
+			return A < B;
+		};
+
+		const int32 NumChunks = bParallel ? FMath::DivideAndRoundUp(NumPoints, TopKChunkSize) : 1;
+		const int32 ChunkSize = FMath::DivideAndRoundUp(NumPoints, NumChunks);
+
+		TArray<TArray<int32>> ChunkCandidates;
+		ChunkCandidates.SetNum(NumChunks);
+
+		ParallelFor(NumChunks, [&ChunkCandidates, &IsBetter, NumPoints, ChunkSize, K](int32 ChunkIndex)
+		{
+			const int32 Start = ChunkIndex * ChunkSize;
+			const int32 Count = FMath::Min(ChunkSize, NumPoints - Start);
+
+			TArray<int32>& Candidates = ChunkCandidates[ChunkIndex];
+			Candidates.SetNumUninitialized(Count);
+			for (int32 Index = 0; Index < Count; ++Index)
+			{
+				Candidates[Index] = Start + Index;
+			}
+
+			if (Count > K)
+			{
+				std::nth_element(Candidates.GetData(), Candidates.GetData() + K, Candidates.GetData() + Count, IsBetter);
+				Candidates.SetNum(K, EAllowShrinking::No);
+			}
+		}, bParallel ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread);
+
+		TArray<int32> Candidates = MoveTemp(ChunkCandidates[0]);
+		for (int32 ChunkIndex = 1; ChunkIndex < NumChunks; ++ChunkIndex)
+		{
+			Candidates.Append(ChunkCandidates[ChunkIndex]);
+		}
+
+		if (Candidates.Num() > K)
+		{
+			std::nth_element(Candidates.GetData(), Candidates.GetData() + K, Candidates.GetData() + Candidates.Num(), IsBetter);
+		}
+
+		for (int32 Index = 0; Index < K; ++Index)
+		{
+			OutSelected[Candidates[Index]] = true;
+		}
+	}
+
+	/** Inputs with at most this many points are batched into a single parallel-for over inputs, instead of each dispatching its own per-point tasks. */
+	static constexpr int32 SmallInputMaxPoints = 4096;
+
+	struct FSelectPointsWorkItem
+	{
+		const UPCGPointData* OriginalData = nullptr;
+		UPCGPointData* SampledData = nullptr;
+		UPCGPointData* DiscardedData = nullptr;
+
+		/** Ranking values, only read in Top-K mode. */
+		TArray<double> Values;
+	};
+
+	/** Computes which points are selected, for every mode. */
+	static void ComputeSelection(const UPCGCSelectPointsCustomSettings* Settings, const FSelectPointsWorkItem& Item, float Ratio, int32 Seed, bool bParallel, TArray<bool>& OutSelected)
+	{
+		const TArray<FPCGPoint>& Points = Item.OriginalData->GetPoints();
+
+		if (Settings->Mode == EPCGCSelectPointsMode::Stratified)
+		{
+			ComputeStratifiedSelection(Points, Settings->CellSize, Ratio, Seed, bParallel, OutSelected);
+		}
+		else if (Settings->Mode == EPCGCSelectPointsMode::TopK)
+		{
+			ComputeTopKSelection(Points, Item.Values, Settings->SelectCount, Settings->bSelectLowest, bParallel, OutSelected);
+
+			if (Settings->InvertSelection)
+			{
+				for (bool& bSelected : OutSelected)
+				{
+					bSelected = !bSelected;
+				}
+			}
+		}
+		else
+		{
+			OutSelected.SetNumUninitialized(Points.Num());
+			for (int32 Index = 0; Index < Points.Num(); ++Index)
+			{
+				OutSelected[Index] = GetPointChance(Seed, Points[Index]) < Ratio;
+			}
+		}
+	}
+
+	/** Single-threaded selection, used when many small inputs are processed in parallel with each other. */
+	static void SelectPointsSerial(const UPCGCSelectPointsCustomSettings* Settings, const FSelectPointsWorkItem& Item, float Ratio, int32 Seed)
+	{
+		const TArray<FPCGPoint>& Points = Item.OriginalData->GetPoints();
+		TArray<FPCGPoint>& SampledPoints = Item.SampledData->GetMutablePoints();
+		TArray<FPCGPoint>& DiscardedPoints = Item.DiscardedData->GetMutablePoints();
+
+		TArray<bool> Selected;
+		ComputeSelection(Settings, Item, Ratio, Seed, /*bParallel=*/false, Selected);
+
+		SampledPoints.Reserve(Points.Num());
+		DiscardedPoints.Reserve(Points.Num());
+
+		for (int32 Index = 0; Index < Points.Num(); ++Index)
+		{
+			if (Selected[Index])
+			{
+				SampledPoints.Add(Points[Index]);
+			}
+			else
+			{
+				DiscardedPoints.Add(Points[Index]);
+			}
+		}
+
+		SampledPoints.Shrink();
+		DiscardedPoints.Shrink();
+	}
+
+	/** Per-point parallel selection, used for large inputs. */
+	static void SelectPointsParallel(FPCGContext* Context, const UPCGCSelectPointsCustomSettings* Settings, const FSelectPointsWorkItem& Item, float Ratio, int32 Seed)
+	{
+		const TArray<FPCGPoint>& Points = Item.OriginalData->GetPoints();
+		TArray<FPCGPoint>& SampledPoints = Item.SampledData->GetMutablePoints();
+		TArray<FPCGPoint>& DiscardedPoints = Item.DiscardedData->GetMutablePoints();
+
+		if (Settings->Mode == EPCGCSelectPointsMode::Random)
+		{
+			FPCGAsync::AsyncPointFilterProcessing(Context, Points.Num(), SampledPoints, DiscardedPoints, [&Points, Seed, Ratio](int32 Index, FPCGPoint& SelectedPoint, FPCGPoint& DiscardedPoint)
+			{
+				const FPCGPoint& Point = Points[Index];
+
+				// Apply a high-pass filter based on selected ratio
+				float Chance = GetPointChance(Seed, Point);
+
+				if (Chance < Ratio)
+				{
+					SelectedPoint = Point;
+					return true;
+				}
+				else
+				{
+					DiscardedPoint = Point;
+					return false;
+				}
+			});
+
+			return;
+		}
+
+		TArray<bool> Selected;
+		ComputeSelection(Settings, Item, Ratio, Seed, /*bParallel=*/true, Selected);
+
+		FPCGAsync::AsyncPointFilterProcessing(Context, Points.Num(), SampledPoints, DiscardedPoints, [&Points, &Selected](int32 Index, FPCGPoint& SelectedPoint, FPCGPoint& DiscardedPoint)
+		{
+			if (Selected[Index])
+			{
+				SelectedPoint = Points[Index];
+				return true;
+			}
+			else
+			{
+				DiscardedPoint = Points[Index];
+				return false;
+			}
+		});
+	}
+}
+
 UPCGCSelectPointsCustomSettings::UPCGCSelectPointsCustomSettings()
 {
 	bUseSeed = true;
@@ -48,7 +542,7 @@ TArray<FPCGPinProperties> UPCGCSelectPointsCustomSettings::OutputPinProperties()
 #if WITH_EDITOR
 FText UPCGCSelectPointsCustomSettings::GetNodeTooltipText() const
 {
-	return LOCTEXT("NodeTooltip", "Selects a stable random subset of the input points.");
+	return LOCTEXT("NodeTooltip", "Selects a stable random subset of the input points. In Stratified mode, the ratio is applied per cell of a spatial grid for an even distribution. In Top K mode, selects the K points with the highest or lowest attribute value.");
 }
 #endif
 
@@ -72,9 +566,12 @@ bool FPCGCSelectPointsCustomElement::ExecuteInternal(FPCGContext* Context) const
 
 	const int Seed = Context->GetSeed();
 
-	const bool bNoSampling = (Ratio <= 0.0f);
-	const bool bTrivialSampling = (Ratio >= 1.0f);
+	//Top-K does not use the ratio, every input has to be ranked
+	const bool bUsesRatio = Settings->Mode != EPCGCSelectPointsMode::TopK;
+	const bool bNoSampling = bUsesRatio && (Ratio <= 0.0f);
+	const bool bTrivialSampling = bUsesRatio && (Ratio >= 1.0f);
 
+	TArray<PCGCSelectPointsCustomHelpers::FSelectPointsWorkItem> WorkItems;
 
 	for (const FPCGTaggedData& Input : Inputs)
 	{
@@ -108,7 +605,7 @@ bool FPCGCSelectPointsCustomElement::ExecuteInternal(FPCGContext* Context) const
 			continue;
 		}
 
-		const UPCGPointData* OriginalData = Cast<UPCGSpatialData>(Input.Data)->ToPointData(Context);
+		const UPCGPointData* OriginalData = PCGCSelectPointsCustomHelpers::ToPointData(Context, Cast<UPCGSpatialData>(Input.Data), Settings->bUseConversionCache);
 
 		if (!OriginalData)
 		{
@@ -116,6 +613,13 @@ bool FPCGCSelectPointsCustomElement::ExecuteInternal(FPCGContext* Context) const
 			continue;
 		}
 
+		TArray<double> Values;
+		if (Settings->Mode == EPCGCSelectPointsMode::TopK && !OriginalData->GetPoints().IsEmpty() && !PCGCSelectPointsCustomHelpers::ReadRankingValues(OriginalData, Settings->Attribute, Settings->bSelectLowest, Values))
+		{
+			PCGE_LOG(Error, GraphAndLog, FText::Format(LOCTEXT("InvalidRankingAttribute", "Attribute '{0}' does not exist or is not numeric"), Settings->Attribute.GetDisplayText()));
+			continue;
+		}
+
 
 		FPCGTaggedData& DiscardedOutput = Outputs.Add_GetRef(Input);
 		DiscardedOutput.Pin = PCGCSelectPointsCustomSettings::DiscardedPointsLabel;
@@ -132,40 +636,57 @@ bool FPCGCSelectPointsCustomElement::ExecuteInternal(FPCGContext* Context) const
 
 		UPCGPointData* SampledData = NewObject<UPCGPointData>();
 		SampledData->InitializeFromData(OriginalData);
-		TArray<FPCGPoint>& SampledPoints = SampledData->GetMutablePoints();
 
 		UPCGPointData* DiscardedData = NewObject<UPCGPointData>();
 		DiscardedData->InitializeFromData(OriginalData);
-		TArray<FPCGPoint>& DiscardedPoints = DiscardedData->GetMutablePoints();
 
 		SelectedOutput.Data = SampledData;
 		DiscardedOutput.Data = DiscardedData;
 
-		TRACE_CPUPROFILER_EVENT_SCOPE(FPCGSelectPointsCustomElement::Execute::SelectPoints);
+		WorkItems.Add({ OriginalData, SampledData, DiscardedData, MoveTemp(Values) });
+	}
 
-		FPCGAsync::AsyncPointFilterProcessing(Context, OriginalPointCount, SampledPoints, DiscardedPoints, [&Points, Seed, Ratio](int32 Index, FPCGPoint& SelectedPoint, FPCGPoint& DiscardedPoint)
-		{
-			const FPCGPoint& Point = Points[Index];
+	//Outputs were created in input order above, the selection itself only fills their points
+	TArray<int32> SmallItems;
+	TArray<int32> LargeItems;
 
-			// Apply a high-pass filter based on selected ratio
-			FRandomStream RandomSource(PCGHelpers::ComputeSeed(Seed, Point.Seed));
-			float Chance = RandomSource.FRand();
+	for (int32 ItemIndex = 0; ItemIndex < WorkItems.Num(); ++ItemIndex)
+	{
+		if (WorkItems[ItemIndex].OriginalData->GetPoints().Num() <= PCGCSelectPointsCustomHelpers::SmallInputMaxPoints)
+		{
+			SmallItems.Add(ItemIndex);
+		}
+		else
+		{
+			LargeItems.Add(ItemIndex);
+		}
+	}
 
-			if (Chance < Ratio)
-			{
-				SelectedPoint = Point;
-				return true;
-			}
-			else
-			{
-				DiscardedPoint = Point;
-				return false;
-			}
+	if (!SmallItems.IsEmpty())
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FPCGSelectPointsCustomElement::Execute::SelectPointsBatched);
 
+		ParallelFor(SmallItems.Num(), [Settings, &WorkItems, &SmallItems, Ratio, Seed](int32 BatchIndex)
+		{
+			PCGCSelectPointsCustomHelpers::SelectPointsSerial(Settings, WorkItems[SmallItems[BatchIndex]], Ratio, Seed);
 		});
+	}
+
+	for (int32 ItemIndex : LargeItems)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FPCGSelectPointsCustomElement::Execute::SelectPoints);
+		PCGCSelectPointsCustomHelpers::SelectPointsParallel(Context, Settings, WorkItems[ItemIndex], Ratio, Seed);
+	}
 
-		PCGE_LOG(Verbose, LogOnly, FText::Format(LOCTEXT("GenerationInfo", "Generated {0} points from {1} source points"), SampledPoints.Num(), OriginalPointCount));
-		
+	for (const PCGCSelectPointsCustomHelpers::FSelectPointsWorkItem& Item : WorkItems)
+	{
+		PCGE_LOG(Verbose, LogOnly, FText::Format(LOCTEXT("GenerationInfo", "Generated {0} points from {1} source points"), Item.SampledData->GetPoints().Num(), Item.OriginalData->GetPoints().Num()));
+	}
+
+	if (Settings->bUseConversionCache)
+	{
+		const FPCGCDataCacheStats Stats = PCGCSelectPointsCustomHelpers::GetConversionCache().GetStats();
+		PCGE_LOG(Verbose, LogOnly, FText::Format(LOCTEXT("ConversionCacheInfo", "Conversion cache: {0} hits, {1} misses, {2} entries"), Stats.Hits, Stats.Misses, Stats.NumEntries));
 	}
 
 	return true;
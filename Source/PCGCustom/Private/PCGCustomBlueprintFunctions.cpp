@@ -2,6 +2,7 @@
 
 #include "PCGCustomBlueprintFunctions.h"
 #include "PCGSubsystem.h"
+#include "PCGCActorIndexSubsystem.h"
 
 void UPCGCustomBlueprintFunctions::RefreshRuntimePCG(UPARAM(DisplayName = "") UPCGComponent* Component, bool Force, EPCGChangeType ChangeType) {
 
@@ -29,3 +30,12 @@ void UPCGCustomBlueprintFunctions::ModifyActor(AActor* Actor) {
 		Actor->Modify();
 #endif
 }
+
+void UPCGCustomBlueprintFunctions::NotifyActorTagsChanged(AActor* Actor) {
+
+	if (Actor) {
+		if (UPCGCActorIndexSubsystem* ActorIndex = UPCGCActorIndexSubsystem::Get(Actor->GetWorld())) {
+			ActorIndex->NotifyActorTagsChanged(Actor);
+		}
+	}
+}
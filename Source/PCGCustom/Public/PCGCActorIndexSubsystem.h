@@ -0,0 +1,124 @@
+// Copyright Roman K. All Rights Reserved.
+
+#pragma once
+
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+
+#include "PCGCActorIndexSubsystem.generated.h"
+
+class AActor;
+class ULevel;
+struct FPCGActorSelectorSettings;
+
+struct FPCGCActorIndexStats
+{
+	int32 NumActors = 0;
+	int32 NumTags = 0;
+	int32 NumClasses = 0;
+	int32 NumGridCells = 0;
+	int64 NumQueries = 0;
+	int64 NumGridQueries = 0;
+};
+
+/**
+ * Index of the world actors by tag and by class, so that actor selectors over all world actors only visit the actors they match.
+ * Kept up to date through the actor spawned/destroyed and level added/removed delegates, and in editor through the property, transaction,
+ * loaded actor (World Partition loading regions) and objects replaced (Blueprint reinstancing) delegates.
+ * Tags changed from code without a property change event have to be notified through NotifyActorTagsChanged, stale tags are filtered out when queried.
+ * In game worlds, actors that can't move are also bucketed in a uniform grid, used to narrow down queries that must overlap the source actor.
+ * Only accessed from the game thread.
+ */
+UCLASS()
+class PCGCUSTOM_API UPCGCActorIndexSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static UPCGCActorIndexSubsystem* Get(const UWorld* World);
+
+	//~Begin USubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	//~End USubsystem interface
+
+	/** Re-indexes the tags of the actor. */
+	void NotifyActorTagsChanged(AActor* Actor);
+
+	/**
+	 * Finds the actors matching the selector, and passing the filter, sorted by name then path.
+	 * This order is deterministic but differs from the world iteration order, so does the actor kept when the selector doesn't select multiple actors.
+	 * OverlapBounds, when valid, lets the grid skip actors that can't overlap it. The filter is still expected to do the exact bounds check.
+	 * Returns false when the selector can't be answered by the index, the caller then has to iterate the world.
+	 */
+	bool FindActors(const FPCGActorSelectorSettings& Selector, const FBox& OverlapBounds, TFunctionRef<bool(const AActor*)> Filter, TArray<AActor*>& OutActors);
+
+	FPCGCActorIndexStats GetStats() const;
+
+	/** Drops the index, it is rebuilt from the world actors on the next query. */
+	void Reset();
+
+private:
+	struct FIndexedActor
+	{
+		TArray<FName> Tags;
+		TObjectKey<UClass> Class;
+
+		/** Grid cells covered by the actor bounds, only valid when the actor is in the grid. */
+		FIntVector MinCell = FIntVector::ZeroValue;
+		FIntVector MaxCell = FIntVector::ZeroValue;
+		bool bIsInGrid = false;
+	};
+
+	void BuildIndex();
+	void AddActor(AActor* Actor);
+	void RemoveActor(const AActor* Actor);
+	void RemoveActor(TObjectKey<AActor> ActorKey);
+	bool CanBeInGrid(const AActor* Actor) const;
+	FIntVector GetCell(const FVector& Position) const;
+
+	void OnActorSpawned(AActor* Actor);
+	void OnActorDestroyed(AActor* Actor);
+	void OnLevelAdded(ULevel* Level, UWorld* World);
+	void OnLevelRemoved(ULevel* Level, UWorld* World);
+
+#if WITH_EDITOR
+	void OnLevelActorAdded(AActor* Actor);
+	void OnLevelActorDeleted(AActor* Actor);
+	void OnObjectPropertyChanged(UObject* Object, struct FPropertyChangedEvent& PropertyChangedEvent);
+	void OnObjectTransacted(UObject* Object, const class FTransactionObjectEvent& TransactionEvent);
+	void OnLoadedActorAdded(AActor& Actor);
+	void OnLoadedActorRemoved(AActor& Actor);
+	void OnObjectsReplaced(const TMap<UObject*, UObject*>& ReplacementMap);
+#endif
+
+	TMap<TObjectKey<AActor>, FIndexedActor> IndexedActors;
+	TMap<FName, TSet<TObjectKey<AActor>>> TagToActors;
+	TMap<TObjectKey<UClass>, TSet<TObjectKey<AActor>>> ClassToActors;
+
+	/** Actors that can't move, per cell. Every other actor is in UngriddedActors. */
+	TMap<FIntVector, TSet<TObjectKey<AActor>>> Grid;
+	TSet<TObjectKey<AActor>> UngriddedActors;
+
+	double GridCellSize = 0.0;
+	bool bUseGrid = false;
+	bool bIsBuilt = false;
+
+	int64 NumQueries = 0;
+	int64 NumGridQueries = 0;
+
+	FDelegateHandle ActorSpawnedHandle;
+	FDelegateHandle ActorDestroyedHandle;
+	FDelegateHandle LevelAddedHandle;
+	FDelegateHandle LevelRemovedHandle;
+
+#if WITH_EDITOR
+	FDelegateHandle LevelActorAddedHandle;
+	FDelegateHandle LevelActorDeletedHandle;
+	FDelegateHandle ObjectPropertyChangedHandle;
+	FDelegateHandle ObjectTransactedHandle;
+	FDelegateHandle LoadedActorAddedHandle;
+	FDelegateHandle LoadedActorRemovedHandle;
+	FDelegateHandle ObjectsReplacedHandle;
+#endif
+};
@@ -32,6 +32,15 @@ public:
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (PCG_Overridable))
 	bool DiscardEmptyData = true;
 
+	//Samples composite data on a lattice to check that it has a positive density somewhere, instead of only checking its bounds.
+	//This is an approximation: features thinner than the finest lattice cell can be missed, and the data is then treated as empty
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (EditCondition = "DiscardEmptyData", PCG_Overridable))
+	bool bSampledCompositeCheck = false;
+
+	//Finest lattice sampled by the check, with 2^Level cells on each axis. Higher levels catch thinner features but cost 8 times more samples per level
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (EditCondition = "DiscardEmptyData && bSampledCompositeCheck", ClampMin = "1", ClampMax = "8", PCG_Overridable))
+	int32 SampledCheckMaxLevel = 5;
+
 protected:
 #if WITH_EDITOR
 	virtual EPCGChangeType GetChangeTypeForProperty(const FName& InPropertyName) const override;
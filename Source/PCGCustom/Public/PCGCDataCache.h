@@ -0,0 +1,87 @@
+// Copyright Roman K. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/GCObject.h"
+#include "UObject/ObjectKey.h"
+#include "Templates/Function.h"
+
+class UPCGData;
+
+struct PCGCUSTOM_API FPCGCDataCacheStats
+{
+	int64 Hits = 0;
+	int64 Misses = 0;
+	int64 Evictions = 0;
+	int32 NumEntries = 0;
+	int64 MemorySize = 0;
+};
+
+/**
+ * Thread-safe cache of PCG data keyed on a 64-bit hash, evicting the least recently used entries when over its memory budget.
+ * Cached data is referenced by the cache, so it stays alive until evicted.
+ */
+class PCGCUSTOM_API FPCGCDataCache : public FGCObject
+{
+public:
+	explicit FPCGCDataCache(const TCHAR* InName, int64 InMemoryBudget = 256 * 1024 * 1024);
+
+	/**
+	 * Returns the cached data and marks it as most recently used, or nullptr. Counts a hit or a miss.
+	 * When Source is given, an entry added for another source is a miss, which guards against key collisions. The source can be any object the key was built from.
+	 */
+	const UPCGData* Find(uint64 Key, const UObject* Source = nullptr);
+
+	/** Adds or replaces the cached data for the key, then evicts entries until the cache fits its budget. Source is only recorded to verify the hits. */
+	void Add(uint64 Key, const UPCGData* Data, const UObject* Source = nullptr);
+
+	/**
+	 * Same as above, for keys built from content instead of objects: the hits are verified on a second hash of the same content,
+	 * computed independently of the key, instead of on the source object.
+	 */
+	const UPCGData* Find(uint64 Key, uint64 Check);
+	void Add(uint64 Key, const UPCGData* Data, uint64 Check);
+
+	/** Drops the cached data for the key, if any. */
+	void Remove(uint64 Key);
+
+	void SetMemoryBudget(int64 InMemoryBudget);
+	void Reset();
+
+	FPCGCDataCacheStats GetStats() const;
+
+	/** Rough memory footprint of the data, used for the budget. */
+	static int64 ComputeMemorySize(const UPCGData* Data);
+
+	/** Combines a value into a cache key. */
+	static uint64 CombineKey(uint64 Key, uint64 Value) { return Key ^ (Value + 0x9e3779b97f4a7c15ull + (Key << 6) + (Key >> 2)); }
+
+	//~Begin FGCObject interface
+	virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+	virtual FString GetReferencerName() const override { return Name; }
+	//~End FGCObject interface
+
+private:
+	struct FEntry
+	{
+		TObjectPtr<const UPCGData> Data;
+		FObjectKey Source;
+		uint64 Check = 0;
+		int64 MemorySize = 0;
+		uint64 LastAccess = 0;
+	};
+
+	const UPCGData* Find_Locked(uint64 Key, TFunctionRef<bool(const FEntry&)> IsValidHit);
+	void Add_Locked(uint64 Key, const UPCGData* Data, int64 DataMemorySize, const FObjectKey& Source, uint64 Check);
+	void EvictToBudget_Locked();
+
+	FString Name;
+	TMap<uint64, FEntry> Entries;
+	int64 MemoryBudget = 0;
+	int64 MemorySize = 0;
+	uint64 AccessCounter = 0;
+	FPCGCDataCacheStats Stats;
+
+	mutable FCriticalSection Lock;
+};
@@ -0,0 +1,28 @@
+// Copyright Roman K. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UPCGData;
+class UPCGSpatialData;
+
+namespace PCGCDataHelpers
+{
+	/** Intersection, difference and union data, also when wrapped in a memoized spatial data. */
+	PCGCUSTOM_API bool IsCompositeData(const UPCGData* Data);
+
+	/**
+	 * Whether the composite data has no sample with a positive density. Without bSampled, only its strict bounds are checked.
+	 * The sampled check tests the centers of lattices of 2, 4, ... 2^MaxLevel cells per axis, in parallel, and stops at the first positive sample.
+	 * It is not exact: features thinner than the finest cell can fall between the samples, and such data is reported as empty.
+	 * Results are kept in a cache bounded by pcgc.SampledCompositeCheck.MaxCachedResults, so several checks of the same data sample it once.
+	 */
+	PCGCUSTOM_API bool IsCompositeDataEmpty(const UPCGSpatialData* Data, bool bSampled, int32 MaxLevel = 5);
+
+	/**
+	 * Number of metadata entries of the data, including the entries inherited from its parent metadata.
+	 * Point data counts its points with a valid metadata entry, so points sharing the entries of a parent are counted too.
+	 */
+	PCGCUSTOM_API int64 GetNumMetadataEntries(const UPCGData* Data);
+}
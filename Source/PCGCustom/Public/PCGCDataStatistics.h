@@ -0,0 +1,44 @@
+// Copyright Roman K. All Rights Reserved. 
+#pragma once
+
+#include "PCGSettings.h"
+#include "Metadata/PCGAttributePropertySelector.h"
+
+#include "PCGCDataStatistics.generated.h"
+
+
+UCLASS(BlueprintType, ClassGroup = (Procedural))
+class PCGCUSTOM_API UPCGCDataStatisticsSettings : public UPCGSettings
+{
+	GENERATED_BODY()
+
+public:
+
+	//~Begin UPCGSettings interface
+#if WITH_EDITOR
+	virtual FName GetDefaultNodeName() const override { return FName(TEXT("DataStatistics")); }
+	virtual FText GetDefaultNodeTitle() const override { return NSLOCTEXT("PCGCDataStatisticsElement", "NodeTitle", "PCGC Data Statistics"); }
+	virtual FText GetNodeTooltipText() const override;
+	virtual EPCGSettingsType GetType() const override { return EPCGSettingsType::Metadata; }
+#endif
+	virtual FString GetAdditionalTitleInformation() const override;
+
+public:
+
+	//Numeric attributes or properties to compute the minimum, maximum and mean of, for every input and for all inputs.
+	//Columns are named after the whole selector, for example $Position.X gives Position_X_Min, Position_X_Max and Position_X_Mean
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (PCG_Overridable))
+	TArray<FPCGAttributePropertyInputSelector> Attributes;
+
+protected:
+	virtual TArray<FPCGPinProperties> InputPinProperties() const override;
+	virtual TArray<FPCGPinProperties> OutputPinProperties() const override;
+	virtual FPCGElementPtr CreateElement() const override;
+	//~End UPCGSettings interface
+};
+
+class FPCGCDataStatisticsElement : public IPCGElement
+{
+protected:
+	virtual bool ExecuteInternal(FPCGContext* Context) const override;
+};
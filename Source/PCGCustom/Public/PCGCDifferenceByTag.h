@@ -3,10 +3,22 @@
 #pragma once
 
 #include "PCGSettings.h"
+#include "PCGContext.h"
 #include "Data/PCGDifferenceData.h"
 
 #include "PCGCDifferenceByTag.generated.h"
 
+class UPCGPointData;
+class UPCGSpatialData;
+
+UENUM()
+enum class EPCGCDifferenceByTagStrategy : uint8
+{
+	Pairwise UMETA(Tooltip = "Each source builds its own difference, adding every higher priority data set one by one."),
+	CumulativeTiers UMETA(Tooltip = "Builds once per priority level the union of every data set above it, so each source subtracts a single prebuilt structure. Point data sets sharing a priority level are merged into one point data, without their attributes. Where their points overlap, the merged data samples a blend of the densities of the overlapping points instead of the highest one, which changes the result of the Minimum and Clamped Subtraction density functions. The merged points are held in memory once for the whole execution."),
+	ClaimCells UMETA(Tooltip = "Point data sets claim the cells of a shared grid, from the highest priority down. Points whose cell is already claimed by another ID are removed. Approximated to the cell size, other data is passed through.")
+};
+
 /**
  * 
  */
@@ -49,6 +61,19 @@ public:
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings)
 		bool bDiffMetadata = true;
 
+	/** How the higher priority data sets are gathered for each source:
+	 * Pairwise - Every source adds each higher priority data set to its own difference.
+	 * Cumulative Tiers - Every source subtracts the prebuilt union of all the levels above its priority. Sources with an ID that also exists at a higher priority fall back to Pairwise.
+	 * Claim Cells - Point sets keep the points whose cell isn't claimed by a higher priority ID, then claim the cells their points cover. One pass over all points, no difference data.
+	 */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings)
+		EPCGCDifferenceByTagStrategy Strategy = EPCGCDifferenceByTagStrategy::Pairwise;
+
+	//Size of the cells claimed by the point sets, a point is removed when the cell of its center is claimed by another ID.
+	//Points covering too many cells only claim the cell of their center.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (EditCondition = "Strategy == EPCGCDifferenceByTagStrategy::ClaimCells", EditConditionHides, ClampMin = "1.0", PCG_Overridable))
+		FVector ClaimCellSize = FVector(100.0, 100.0, 100.0);
+
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (InlineEditConditionToggle, PCG_Overridable))
 		bool bUsingCustomTags = false;
 
@@ -58,10 +83,83 @@ public:
 
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, DisplayName = "Exclude Tags From Difference", meta = (PCG_Overridable))
 		FString ExcludeTags;
+
+	//Only subtract the data sets whose bounds overlap the source, found through a bounding volume hierarchy built once per execution
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, AdvancedDisplay, meta = (EditCondition = "Strategy == EPCGCDifferenceByTagStrategy::Pairwise"))
+		bool bUseBoundsBroadphase = true;
+
+	//On partitioned components, data sets outside of the executing partition are never subtracted from the other sets.
+	//They are still sources, the sets inside the partition are subtracted from them.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, AdvancedDisplay)
+		bool bClipToPartitionBounds = false;
+
+	//When the source and everything subtracted from it are point data, subtract the points through a spatial hash instead of sampling each difference.
+	//This is an approximation of the difference: overlaps are measured on the axis aligned world bounds of the points, ignoring their rotation and steepness,
+	//and the overlapping densities are averaged instead of taking the highest set. Rotated points are over-removed, and densities other than Binary differ.
+	//Falls back to the regular difference when attributes have to be diffed.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, AdvancedDisplay)
+		bool bUsePointSpatialHash = false;
+
+	//Reuse the converted difference of a source when its content and the content of the data sets subtracted from it match a previous execution,
+	//so that when a single actor changes upstream, only the sources it overlaps are recomputed. Point data is compared on the CRC of its points and attributes,
+	//other data on its identity, so rebuilt non-point data is always recomputed. Matching on CRCs can in rare cases reuse the result of different content.
+	//Results are shared by every node, see pcgc.DifferenceByTag.ResultCacheStats and pcgc.DifferenceByTag.ResultCacheBudgetMB.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, AdvancedDisplay)
+		bool bMemoizeResults = false;
+
+	//Wrap the continuous differences in a data that memoizes its samples, for results sampled at the same locations by several nodes
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, AdvancedDisplay)
+		bool bMemoizeSampling = false;
+
+	//Sample locations and bounds are rounded to this step to find a memoized sample
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, AdvancedDisplay, meta = (EditCondition = "bMemoizeSampling", ClampMin = "0.001"))
+		double SamplingQuantization = 1.0;
+
+	//Maximum number of memoized samples per output
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, AdvancedDisplay, meta = (EditCondition = "bMemoizeSampling", ClampMin = "16"))
+		int32 SamplingCacheMaxEntries = 65536;
+};
+
+/** An output holding a difference that still has to be converted to points. */
+struct FPCGCDifferenceByTagConversion
+{
+	int32 OutputIndex = INDEX_NONE;
+
+	/** Only set when the difference can be computed through the point spatial hash. */
+	const UPCGPointData* SourcePoints = nullptr;
+	TArray<const UPCGPointData*> DifferencePoints;
+
+	uint64 ResultKey = 0;
+
+	/** Second hash of the values making the key, a hit whose check differs is treated as a miss. */
+	uint64 ResultCheck = 0;
+	bool bMemoizeResult = false;
+};
+
+class FPCGCDifferenceByTagContext : public FPCGContext
+{
+public:
+	bool bPreparedDifferences = false;
+
+	TArray<FPCGCDifferenceByTagConversion> PendingConversions;
+	int32 NumConvertedDifferences = 0;
+
+	/** Sources whose converted difference was found in the result cache. */
+	int32 NumReusedResults = 0;
 };
 
 class FPCGCDifferenceByTagElement : public IPCGElement
 {
 protected:
+	virtual FPCGContext* CreateContext() override;
 	virtual bool ExecuteInternal(FPCGContext* Context) const;
+
+	/** Builds the outputs in input order, with the difference data of every source. */
+	void PrepareDifferences(FPCGCDifferenceByTagContext* Context, const UPCGCDifferenceByTagSettings* Settings) const;
+
+	/** Converts the pending differences to points in parallel batches, returns false when the time slice is over. */
+	bool ConvertDifferences(FPCGCDifferenceByTagContext* Context) const;
+
+	/** Claim Cells strategy, filters the point sets against the cells claimed by the higher priority IDs. */
+	void ClaimCells(FPCGCDifferenceByTagContext* Context, const UPCGCDifferenceByTagSettings* Settings) const;
 };
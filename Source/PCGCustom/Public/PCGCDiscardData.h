@@ -5,6 +5,14 @@
 
 #include "PCGCDiscardData.generated.h"
 
+UENUM()
+enum class EPCGCDiscardDataSizeMetric : uint8
+{
+	PointCount UMETA(Tooltip = "Number of points of point data, other data counts as 0."),
+	EntryCount UMETA(Tooltip = "Number of metadata entries of point data and attribute sets, other data counts as 0."),
+	BoundsVolume UMETA(Tooltip = "Volume of the bounds of spatial data, other data counts as 0.")
+};
+
 UCLASS(BlueprintType, ClassGroup = (Procedural))
 class PCGCUSTOM_API UPCGCDiscardDataSettings : public UPCGSettings
 {
@@ -24,6 +32,54 @@ public:
 
 	virtual bool HasDynamicPins() const override { return true; }
 
+public:
+
+	//Samples composite data on a lattice to check that it has a positive density somewhere, instead of only checking its bounds.
+	//This is an approximation: features thinner than the finest lattice cell can be missed, and the data is then treated as empty
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (PCG_Overridable))
+	bool bSampledCompositeCheck = false;
+
+	//Finest lattice sampled by the check, with 2^Level cells on each axis. Higher levels catch thinner features but cost 8 times more samples per level
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (EditCondition = "bSampledCompositeCheck", ClampMin = "1", ClampMax = "8", PCG_Overridable))
+	int32 SampledCheckMaxLevel = 5;
+
+	//Also discards data identical to an earlier input, compared on its content. The first occurrence and its tags are kept
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (PCG_Overridable))
+	bool bDiscardDuplicates = false;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|Thresholds", meta = (InlineEditConditionToggle, PCG_Overridable))
+	bool bUseMinPoints = false;
+
+	//Discards point data with fewer points
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|Thresholds", meta = (EditCondition = "bUseMinPoints", ClampMin = "0", PCG_Overridable))
+	int32 MinPoints = 1;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|Thresholds", meta = (InlineEditConditionToggle, PCG_Overridable))
+	bool bUseMinEntries = false;
+
+	//Discards point data and attribute sets with fewer metadata entries, inherited entries included.
+	//Point data counts its points with a metadata entry, so point data whose points have no entries is discarded
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|Thresholds", meta = (EditCondition = "bUseMinEntries", ClampMin = "0", PCG_Overridable))
+	int32 MinEntries = 1;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|Thresholds", meta = (InlineEditConditionToggle, PCG_Overridable))
+	bool bUseMinBoundsVolume = false;
+
+	//Discards spatial data whose bounds have a smaller volume
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|Thresholds", meta = (EditCondition = "bUseMinBoundsVolume", ClampMin = "0", PCG_Overridable))
+	double MinBoundsVolume = 1.0;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|Thresholds", meta = (InlineEditConditionToggle, PCG_Overridable))
+	bool bKeepLargest = false;
+
+	//Only keeps the largest data sets, in their input order
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|Thresholds", DisplayName = "Keep Largest K", meta = (EditCondition = "bKeepLargest", ClampMin = "0", PCG_Overridable))
+	int32 KeepLargestCount = 1;
+
+	//How the size of the data sets is measured for Keep Largest K
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Settings|Thresholds", meta = (EditCondition = "bKeepLargest", PCG_Overridable))
+	EPCGCDiscardDataSizeMetric SizeMetric = EPCGCDiscardDataSizeMetric::PointCount;
+
 protected:
 #if WITH_EDITOR
 	virtual EPCGChangeType GetChangeTypeForProperty(const FName& InPropertyName) const override;
@@ -7,8 +7,14 @@
 #include "Elements/PCGActorSelector.h"
 #include "PCGPin.h"
 
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Components/SplineComponent.h"
 #include "UObject/ObjectKey.h"
 
+class UPCGParamData;
+class UPCGPointData;
+class UStaticMesh;
+
 #include "PCGCGetActorDataExtended.generated.h"
 
 
@@ -24,6 +30,13 @@ enum class EPCGGetDataFromActorModeExtended : uint8
 };
 
 
+UENUM()
+enum class EPCGCSplineSamplingMode : uint8
+{
+	Distance UMETA(Tooltip = "Samples the spline every Spline Sampling Distance along its length."),
+	Subdivision UMETA(Tooltip = "Samples every control point of the spline, and evenly spaced points between consecutive control points.")
+};
+
 UCLASS(BlueprintType, ClassGroup = (Procedural))
 class PCGCUSTOM_API UPCGCGetActorDataExtendedSettings : public UPCGSettings
 {
@@ -70,6 +83,9 @@ public:
 
 	const FName PropertiesPinName = TEXT("Properties");
 	const FName ComponentsPinName = TEXT("Components");
+	const FName SplinesPinName = TEXT("Splines");
+	const FName SocketsPinName = TEXT("Sockets");
+	const FName VerticesPinName = TEXT("Vertices");
 
 	/** Describes which actors to select for data collection. */
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "ActorSelectorSettings", meta = (ShowOnlyInnerProperties, PCG_Overridable))
@@ -81,6 +97,12 @@ public:
 		bool bTrackActorsOnlyWithinBounds = true;
 #endif // WITH_EDITORONLY_DATA
 
+	/** Find the actors through the world actor index instead of iterating the world, when selecting all world actors by tag or by class.
+	  * Tags changed from code without a property change event must be notified with Notify Actor Tags Changed to be found.
+	  * Found actors are sorted by name instead of following the world order, which also changes the actor kept when Select Multiple is off. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "ActorSelectorSettings", AdvancedDisplay)
+		bool bUseActorIndex = false;
+
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "SpatialData")
 		bool bGetSpatialData = true;
 
@@ -135,6 +157,11 @@ public:
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "ActorProperties", meta = (EditCondition = "bGetActorProperties"))
 		TArray<FName> PropertiesNames = {};
 
+	/** Extract the properties of all found actors into a single attribute set, with one entry per actor, instead of one attribute set per actor.
+	  * Actors missing a property get the attribute default value. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "ActorProperties", meta = (EditCondition = "bGetActorProperties"))
+		bool bMergeActorProperties = false;
+
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "ActorComponents")
 		bool bGetActorComponentsAsPoints = false;
 
@@ -147,6 +174,163 @@ public:
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "ActorComponents", meta = (EditCondition = "bGetActorComponentsAsPoints"))
 		TArray<TSubclassOf<UPrimitiveComponent>> ExclusionClasses;
 
+	/** Output the components of all found actors as a single point data, instead of one point data per actor tagged with the actor tags. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "ActorComponents", meta = (EditCondition = "bGetActorComponentsAsPoints"))
+		bool bMergeComponentsPoints = false;
+
+	// Specify the names of the Attributes which will contain tags, mapped from the tags of the actor owning the component.
+	// Mapping is done by the tag index, like for the component tags
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "ActorComponents", meta = (EditCondition = "bGetActorComponentsAsPoints && bMergeComponentsPoints"))
+		TArray<FName> ActorTagAttributeNames = {};
+
+	/** Output a point per instance for instanced static mesh components, instead of a point per component. Points use the bounds of the instanced mesh. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "ActorComponents", meta = (EditCondition = "bGetActorComponentsAsPoints"))
+		bool bExtractInstances = false;
+
+	// Specify the names of the Attributes which will contain the per-instance custom data.
+	// Mapping is done by the custom data index, for example: InstanceCustomDataAttributeName with index 0 will contain custom data float with index 0
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "ActorComponents", meta = (EditCondition = "bGetActorComponentsAsPoints && bExtractInstances"))
+		TArray<FName> InstanceCustomDataAttributeNames = {};
+
+	/** Sample the spline components of all found actors into a single point data on the Splines pin, instead of a point per spline component. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "ActorComponents|Splines", meta = (EditCondition = "bGetActorComponentsAsPoints"))
+		bool bSampleSplines = false;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "ActorComponents|Splines", meta = (EditCondition = "bGetActorComponentsAsPoints && bSampleSplines"))
+		EPCGCSplineSamplingMode SplineSamplingMode = EPCGCSplineSamplingMode::Distance;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "ActorComponents|Splines", meta = (ClampMin = "1.0", EditCondition = "bGetActorComponentsAsPoints && bSampleSplines && SplineSamplingMode == EPCGCSplineSamplingMode::Distance", EditConditionHides))
+		double SplineSamplingDistance = 100.0;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "ActorComponents|Splines", meta = (ClampMin = "0", EditCondition = "bGetActorComponentsAsPoints && bSampleSplines && SplineSamplingMode == EPCGCSplineSamplingMode::Subdivision", EditConditionHides))
+		int32 SplineSubdivisionsPerSegment = 0;
+
+	/** Name of the attribute holding the index of the sampled spline, counted over all found actors. Not written when None. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "ActorComponents|Splines", meta = (EditCondition = "bGetActorComponentsAsPoints && bSampleSplines"))
+		FName SplineIndexAttributeName = TEXT("SplineIndex");
+
+	/** Output a point per socket of the static mesh components of all found actors, on the Sockets pin. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "ActorComponents|Meshes", meta = (EditCondition = "bGetActorComponentsAsPoints"))
+		bool bExtractMeshSockets = false;
+
+	/** Name of the attribute holding the socket name. Not written when None. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "ActorComponents|Meshes", meta = (EditCondition = "bGetActorComponentsAsPoints && bExtractMeshSockets"))
+		FName SocketAttributeName = TEXT("Socket");
+
+	/** Output a point per vertex of the static mesh components of all found actors, on the Vertices pin. Cooked builds need Allow CPU Access on the meshes. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "ActorComponents|Meshes", meta = (EditCondition = "bGetActorComponentsAsPoints"))
+		bool bExtractMeshVertices = false;
+
+	/** LOD to read the vertices from, clamped to the LODs of each mesh. LODs streamed out at the time of the execution are replaced by the first resident LOD, with a warning. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "ActorComponents|Meshes", meta = (ClampMin = "0", EditCondition = "bGetActorComponentsAsPoints && bExtractMeshVertices"))
+		int32 VertexLOD = 0;
+
+	/** Name of the attribute holding the world space vertex normal. Not written when None. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "ActorComponents|Meshes", meta = (EditCondition = "bGetActorComponentsAsPoints && bExtractMeshVertices"))
+		FName NormalAttributeName = TEXT("Normal");
+
+	/** Reuse the single points, properties and components of the actors that didn't change since a previous execution, instead of rebuilding them.
+	  * Actors are compared on a CRC of their transform, tags, primitive components and selected properties. Merged outputs are always rebuilt.
+	  * Outputs are shared by every node, see pcgc.GetActorData.ActorCacheStats and pcgc.GetActorData.ActorCacheBudgetMB. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Cache", AdvancedDisplay)
+		bool bCacheActorData = false;
+
+};
+
+/** Copy of a property value, so it can be read on worker threads once the game thread moved on. */
+class FPCGCPropertyValueSnapshot
+{
+public:
+	FPCGCPropertyValueSnapshot(const FProperty* InProperty, const void* InContainer);
+	~FPCGCPropertyValueSnapshot();
+
+	FPCGCPropertyValueSnapshot(const FPCGCPropertyValueSnapshot&) = delete;
+	FPCGCPropertyValueSnapshot& operator=(const FPCGCPropertyValueSnapshot&) = delete;
+
+	/** Pointer to pass as container to the property, so that ContainerPtrToValuePtr lands on the copied value. */
+	const void* GetContainerPtr() const;
+
+	const FProperty* Property = nullptr;
+
+private:
+	uint8* Value = nullptr;
+};
+
+/** Property path resolved once per actor class. Nested properties are read from the struct or object held by OuterProperty. */
+struct FPCGCResolvedActorProperty
+{
+	FName AttributeName;
+	const FProperty* OuterProperty = nullptr;
+	const FProperty* Property = nullptr;
+};
+
+struct FPCGCResolvedActorProperties
+{
+	TArray<FPCGCResolvedActorProperty> Properties;
+};
+
+struct FPCGCActorPropertySnapshot
+{
+	FName AttributeName;
+	TSharedPtr<const FPCGCPropertyValueSnapshot> Value;
+};
+
+struct FPCGCComponentSnapshot
+{
+	FTransform Transform;
+	FBox LocalBounds = FBox(EForceInit::ForceInit);
+	TArray<FName> Tags;
+
+	/** Instances in component space and their custom data, when extracting the instances of an instanced static mesh component. */
+	TArray<FInstancedStaticMeshInstanceData> Instances;
+	TArray<float> InstanceCustomData;
+	int32 NumCustomDataFloats = 0;
+	bool bIsInstanced = false;
+
+	int32 GetNumPoints() const { return bIsInstanced ? Instances.Num() : 1; }
+};
+
+struct FPCGCSplineSnapshot
+{
+	FSplineCurves Curves;
+	FTransform Transform;
+	FVector DefaultUpVector = FVector::UpVector;
+	TArray<FName> Tags;
+};
+
+/** Mesh space sockets and vertices of a static mesh, extracted once and shared by all the components using the mesh, across executions. */
+struct FPCGCMeshLocalData
+{
+	TArray<FName> SocketNames;
+	TArray<FTransform> SocketTransforms;
+	TArray<FVector3f> VertexPositions;
+	TArray<FVector3f> VertexNormals;
+};
+
+struct FPCGCMeshSnapshot
+{
+	TSharedPtr<const FPCGCMeshLocalData> LocalData;
+	FTransform Transform;
+	TArray<FName> Tags;
+};
+
+/** Everything the worker phase reads from a found actor, captured on the game thread. */
+struct FPCGCActorSnapshot
+{
+	TArray<FName> Tags;
+	TArray<FPCGCActorPropertySnapshot> Properties;
+	TArray<FPCGCComponentSnapshot> Components;
+	TArray<FPCGCSplineSnapshot> Splines;
+	TArray<FPCGCMeshSnapshot> Meshes;
+
+	/** Actor cache keys of the properties and components outputs, zero when they are not cached. Hits are verified against the actor. */
+	FObjectKey Actor;
+	uint64 PropertiesCacheKey = 0;
+	uint64 ComponentsCacheKey = 0;
+
+	/** Index in the context output data of the cached outputs, held there from the PrepareData phase until the outputs are assembled. INDEX_NONE when built from the snapshot. */
+	int32 CachedPropertiesIndex = INDEX_NONE;
+	int32 CachedComponentsIndex = INDEX_NONE;
 };
 
 class FPCGDataFromActorContext : public FPCGContext
@@ -155,6 +339,9 @@ public:
 	TArray<AActor*> FoundActors;
 	bool bPerformedQuery = false;
 
+	/** Built at the end of the PrepareData phase, one per found actor. */
+	TArray<FPCGCActorSnapshot> ActorSnapshots;
+
 #if WITH_EDITOR
 	/** Any change origin ignores we added, to solve dependency issues (like upstream execution cancelling downstream graph). */
 	TArray<TObjectKey<UObject>> IgnoredChangeOrigins;
@@ -165,13 +352,15 @@ class FPCGCGetActorDataExtendedElement : public IPCGElement
 {
 public:
 //	virtual FPCGContext* Initialize(const FPCGDataCollection& InputData, TWeakObjectPtr<UPCGComponent> SourceComponent, const UPCGNode* Node) override;
-	virtual bool CanExecuteOnlyOnMainThread(FPCGContext* Context) const override { return true; }
+	/** Only the query and the snapshot of the actors (PrepareData phase) need the game thread, data is built from the snapshot on workers. */
+	virtual bool CanExecuteOnlyOnMainThread(FPCGContext* Context) const override { return !Context || Context->CurrentPhase == EPCGExecutionPhase::PrepareData; }
 	virtual void GetDependenciesCrc(const FPCGDataCollection& InInput, const UPCGSettings* InSettings, UPCGComponent* InComponent, FPCGCrc& OutCrc) const override;
 	virtual bool ShouldComputeFullOutputDataCrc(FPCGContext* Context) const override { return true; }
 //	virtual bool IsCacheable(const UPCGSettings* InSettings) const override { return false; }
 
 protected:
 	virtual FPCGContext* CreateContext() override;
+	virtual bool PrepareDataInternal(FPCGContext* Context) const override;
 	virtual bool ExecuteInternal(FPCGContext* Context) const;
 	void GatherWaitTasks(AActor* FoundActor, FPCGContext* InContext, TArray<FPCGTaskId>& OutWaitTasks) const;
 	virtual void ProcessActors(FPCGContext* Context, const UPCGCGetActorDataExtendedSettings* Settings, const TArray<AActor*>& FoundActors) const;
@@ -179,6 +368,16 @@ protected:
 
 	void MergeActorsIntoPointData(FPCGContext* Context, const UPCGCGetActorDataExtendedSettings* Settings, const TArray<AActor*>& FoundActors) const;
 
-	void GetActorProperties(FPCGContext* Context, const UPCGCGetActorDataExtendedSettings* Settings, AActor* FoundActor) const;
-	void GetActorComponentsAsPoints(FPCGContext* Context, const UPCGCGetActorDataExtendedSettings* Settings, AActor* FoundActor) const;
+	/** Resolves the property names against an actor class, logs and returns false on the first property that can't be extracted. */
+	bool ResolveActorProperties(FPCGContext* Context, const UPCGCGetActorDataExtendedSettings* Settings, const UClass* ActorClass, FPCGCResolvedActorProperties& OutResolvedProperties) const;
+	void SnapshotActorProperties(const FPCGCResolvedActorProperties& ResolvedProperties, AActor* FoundActor, FPCGCActorSnapshot& OutSnapshot) const;
+	void SnapshotActorComponents(FPCGContext* Context, const UPCGCGetActorDataExtendedSettings* Settings, AActor* FoundActor, TMap<const UStaticMesh*, TSharedPtr<const FPCGCMeshLocalData>>& MeshLocalDataCache, FPCGCActorSnapshot& OutSnapshot) const;
+
+	/** Worker side, reads only the snapshot. */
+	UPCGParamData* GetActorProperties(const FPCGCActorSnapshot& Snapshot, TArray<FName>& OutFailedProperties) const;
+	UPCGParamData* GetMergedActorProperties(TConstArrayView<FPCGCActorSnapshot> Snapshots, TArray<FName>& OutFailedProperties) const;
+	/** Single point data for the components of the snapshots. Actor tags are only written to attributes when the points of several actors are merged. */
+	UPCGPointData* GetComponentsAsPoints(const UPCGCGetActorDataExtendedSettings* Settings, TConstArrayView<FPCGCActorSnapshot> Snapshots, bool bWriteActorTags) const;
+	UPCGPointData* GetSplinesAsPoints(const UPCGCGetActorDataExtendedSettings* Settings, TConstArrayView<FPCGCActorSnapshot> Snapshots) const;
+	UPCGPointData* GetMeshesAsPoints(const UPCGCGetActorDataExtendedSettings* Settings, TConstArrayView<FPCGCActorSnapshot> Snapshots, bool bVertices) const;
 };
@@ -0,0 +1,103 @@
+// Copyright Roman K. All Rights Reserved.
+
+#pragma once
+
+#include "Data/PCGSpatialData.h"
+#include "Misc/ScopeRWLock.h"
+
+#include <atomic>
+
+#include "PCGCMemoizedSpatialData.generated.h"
+
+/**
+ * Wraps a spatial data and memoizes its samples, keyed on the quantized sample transform and bounds.
+ * Meant for lazy data, like differences, that are sampled at the same locations by several downstream nodes.
+ * Only the sampled density, color and steepness are memoized. The point is always rebuilt from the requested transform and bounds, with a seed
+ * derived from its position and no metadata entry, whether the sample was memoized or not, so the result doesn't depend on the sampling order.
+ * Changes the inner data makes to the sampled transform, like a projection, are not kept.
+ * Samples with an output metadata are never memoized, since the entries are created in the caller's metadata.
+ */
+UCLASS(BlueprintType, ClassGroup = (Procedural))
+class PCGCUSTOM_API UPCGCMemoizedSpatialData : public UPCGSpatialData
+{
+	GENERATED_BODY()
+
+public:
+	void Initialize(const UPCGSpatialData* InData, double InQuantization, int32 InMaxEntries);
+
+	const UPCGSpatialData* GetInnerData() const { return Inner; }
+
+	/** Number of memoized samples, and of the samples answered from them. */
+	int32 GetNumEntries() const;
+	int64 GetNumHits() const { return NumHits.load(std::memory_order_relaxed); }
+
+	//~Begin UPCGData interface
+	virtual EPCGDataType GetDataType() const override { return Inner ? Inner->GetDataType() : EPCGDataType::Spatial; }
+	virtual void AddToCrc(FArchiveCrc32& Ar, bool bFullDataCrc) const override;
+	//~End UPCGData interface
+
+	//~Begin UPCGSpatialData interface
+	virtual int GetDimension() const override { return Inner ? Inner->GetDimension() : 0; }
+	virtual FBox GetBounds() const override { return Inner ? Inner->GetBounds() : FBox(EForceInit::ForceInit); }
+	virtual FBox GetStrictBounds() const override { return Inner ? Inner->GetStrictBounds() : FBox(EForceInit::ForceInit); }
+	virtual FVector GetNormal() const override { return Inner ? Inner->GetNormal() : FVector::UnitZ(); }
+	virtual bool SamplePoint(const FTransform& Transform, const FBox& Bounds, FPCGPoint& OutPoint, UPCGMetadata* OutMetadata) const override;
+	virtual const UPCGPointData* ToPointData(FPCGContext* Context, const FBox& InBounds = FBox(EForceInit::ForceInit)) const override;
+	virtual bool HasNonTrivialTransform() const override { return Inner && Inner->HasNonTrivialTransform(); }
+	virtual bool RequiresCollapseToSample() const override { return Inner && Inner->RequiresCollapseToSample(); }
+protected:
+	virtual UPCGSpatialData* CopyInternal() const override;
+	//~End UPCGSpatialData interface
+
+	UPROPERTY()
+	TObjectPtr<const UPCGSpatialData> Inner = nullptr;
+
+	UPROPERTY()
+	double Quantization = 1.0;
+
+	UPROPERTY()
+	int32 MaxEntries = 65536;
+
+private:
+	/** Only what doesn't depend on the caller, the transform, bounds, seed and entry of the point do. */
+	struct FSample
+	{
+		FVector4 Color = FVector4::One();
+		float Density = 0.0f;
+		float Steepness = 0.0f;
+		bool bInside = false;
+	};
+
+	/** Quantized transform and bounds of a sample, compared in full on a hit so that hash collisions are told apart. */
+	struct FSampleKey
+	{
+		FInt64Vector Location = FInt64Vector::ZeroValue;
+		FInt64Vector BoundsMin = FInt64Vector::ZeroValue;
+		FInt64Vector BoundsMax = FInt64Vector::ZeroValue;
+		FQuat Rotation = FQuat::Identity;
+		FVector Scale = FVector::OneVector;
+		uint32 Hash = 0;
+
+		bool operator==(const FSampleKey& Other) const
+		{
+			return Location == Other.Location && BoundsMin == Other.BoundsMin && BoundsMax == Other.BoundsMax && Rotation == Other.Rotation && Scale == Other.Scale;
+		}
+
+		friend uint32 GetTypeHash(const FSampleKey& Key) { return Key.Hash; }
+	};
+
+	/** The cache is split in shards, so concurrent samplers rarely wait on each other. */
+	struct FShard
+	{
+		FRWLock Lock;
+		TMap<FSampleKey, FSample> Samples;
+	};
+
+	static constexpr int32 NumShards = 16;
+
+	FSampleKey ComputeKey(const FTransform& Transform, const FBox& Bounds) const;
+	static void MakePoint(const FTransform& Transform, const FBox& Bounds, const FSample& Sample, FPCGPoint& OutPoint);
+
+	mutable FShard Shards[NumShards];
+	mutable std::atomic<int64> NumHits = 0;
+};
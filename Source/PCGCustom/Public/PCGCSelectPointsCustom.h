@@ -4,9 +4,18 @@
 #pragma once
 
 #include "PCGSettings.h"
+#include "Metadata/PCGAttributePropertySelector.h"
 
 #include "PCGCSelectPointsCustom.generated.h"
 
+UENUM()
+enum class EPCGCSelectPointsMode : uint8
+{
+	Random UMETA(Tooltip = "Each point is kept with a probability equal to the ratio."),
+	Stratified UMETA(Tooltip = "Points are bucketed into a spatial grid and the ratio is applied per cell, which gives an even spatial distribution."),
+	TopK UMETA(DisplayName = "Top K", Tooltip = "Selects the K points with the highest (or lowest) value of a numeric attribute. Ties are broken on the point seed.")
+};
+
 UCLASS(BlueprintType, ClassGroup = (Procedural))
 class PCGCUSTOM_API UPCGCSelectPointsCustomSettings : public UPCGSettings
 {
@@ -32,11 +41,35 @@ protected:
 	//~End UPCGSettings interface
 
 public:
-	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta=(ClampMin="0", ClampMax="1", PCG_Overridable))
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta=(EditCondition = "Mode != EPCGCSelectPointsMode::TopK", ClampMin="0", ClampMax="1", PCG_Overridable))
 		float Ratio = 0.1f;
 
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (PCG_Overridable))
 		bool InvertSelection = false;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (PCG_Overridable))
+		EPCGCSelectPointsMode Mode = EPCGCSelectPointsMode::Random;
+
+	//Size of the grid cells used to stratify the selection, the ratio is applied to the points of each cell separately
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (EditCondition = "Mode == EPCGCSelectPointsMode::Stratified", EditConditionHides, ClampMin = "0.1", PCG_Overridable))
+		FVector CellSize = FVector(200.0, 200.0, 200.0);
+
+	//Numeric attribute or property used to rank the points
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (EditCondition = "Mode == EPCGCSelectPointsMode::TopK", EditConditionHides, PCG_Overridable))
+		FPCGAttributePropertyInputSelector Attribute;
+
+	//Number of points to select in each data set
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, DisplayName = "K", meta = (EditCondition = "Mode == EPCGCSelectPointsMode::TopK", EditConditionHides, ClampMin = "0", PCG_Overridable))
+		int32 SelectCount = 200;
+
+	//Select the K lowest values instead of the K highest
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (EditCondition = "Mode == EPCGCSelectPointsMode::TopK", EditConditionHides, PCG_Overridable))
+		bool bSelectLowest = false;
+
+	//Cache the point data converted from non-point inputs (surfaces, volumes, composite data), so other Split Points nodes of the same graph execution reading the same data reuse it.
+	//Conversions are released when the component generates again, or evicted earlier when over pcgc.SplitPoints.ConversionCacheBudgetMB.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, AdvancedDisplay)
+		bool bUseConversionCache = true;
 };
 
 class FPCGCSelectPointsCustomElement : public IPCGElement
@@ -21,4 +21,8 @@ public:
 
 	UFUNCTION(BlueprintCallable, category = "PCGC Blueprint Functions")
 		static void ModifyActor(AActor* Actor);
+
+	//Call after changing the tags of an actor at runtime, so that Get Actor Data Extended nodes using the actor index find it by its new tags
+	UFUNCTION(BlueprintCallable, category = "PCGC Blueprint Functions")
+		static void NotifyActorTagsChanged(AActor* Actor);
 };